@@ -10,8 +10,12 @@
 
 #include "disruptor/RingBuffer.h"
 #include "Semaphore.h"
+#include "Sleep.h"
+#include "ThreadFactory.h"
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <mutex>
 
 class WaitStrategy {
 public:
@@ -19,6 +23,13 @@ public:
 
 	virtual void wait() = 0;
 	virtual void newData() = 0;
+
+	// waits until hasData() holds or newData() is called
+	virtual void waitFor(const std::function<bool()>& hasData) {
+		if (!hasData()) {
+			wait();
+		}
+	}
 };
 
 class MessageWaitStrategy:public WaitStrategy {
@@ -29,7 +40,11 @@ public:
 	MessageWaitStrategy(unsigned long timeoutMS) : m_timeout(timeoutMS) {}
 
 	void wait() {
-        m_semaphore.try_wait_for(1, std::chrono::milliseconds(m_timeout));
+		if (m_timeout < 0) {
+			m_semaphore.wait();
+		} else {
+			m_semaphore.try_wait_for(std::chrono::milliseconds(m_timeout));
+		}
 	}
 
 	void newData() {
@@ -42,6 +57,66 @@ private:
     semaphore m_semaphore;
 };
 
+/** Spins a little, then parks until a producer signals
+ *
+ *  newData() only takes the lock when the consumer is parked, so a
+ *  busy active object costs its producers a fence and a load per
+ *  message instead of a lock and a notify. The timeout is only a
+ *  safety net.
+ */
+class ParkingWaitStrategy: public WaitStrategy {
+public:
+
+	ParkingWaitStrategy(size_t spinTries = 1000, size_t timeoutUS = 100000)
+		: m_spinTries(spinTries)
+		, m_timeout(timeoutUS)
+		, m_parked(false)
+	{}
+
+	void wait() {
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_parked.store(true);
+		m_condition.wait_for(lock, m_timeout);
+		m_parked.store(false);
+	}
+
+	void waitFor(const std::function<bool()>& hasData) {
+		for (size_t i = 0; i < m_spinTries; ++i) {
+			if (hasData()) {
+				return;
+			}
+			SleepUtil::cpuRelax();
+		}
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		while (true) {
+			m_parked.store(true);
+			// pairs with the fence in newData, either we see the data or the producer sees us parked
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (hasData()) {
+				m_parked.store(false);
+				return;
+			}
+			m_condition.wait_for(lock, m_timeout);
+		}
+	}
+
+	void newData() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_parked.load(std::memory_order_relaxed) && m_parked.exchange(false)) {
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_condition.notify_one();
+		}
+	}
+
+private:
+	const size_t m_spinTries;
+	const std::chrono::microseconds m_timeout;
+	std::atomic<bool> m_parked;
+	std::mutex m_lock;
+	std::condition_variable m_condition;
+};
+
 
 /** Implementa o padrão Active Object
  *
@@ -52,14 +127,19 @@ private:
  *  O active object possui um loop em que as mensagens são
  *  processadas uma a uma pela thread interna.
  *
- *  Essa implementação de ActiveObject pode ser configurada
- *  para usar uma fila padrão ou usar uma fila de prioridade.
- *  Usando a fila de prioridade as mensagens devem implementar
- *  um método de comparação que diz se sua prioridade é maior
- *  ou não que a de outra mensagem.
+ *  As mensagens são processadas na ordem de chegada. Para
+ *  mensagens com prioridades diferentes veja PriorityActive,
+ *  que tem uma fila para cada prioridade.
+ *
+ *  A thread interna executa de uma vez todas as mensagens
+ *  disponíveis. Cada posição da fila é liberada antes de sua
+ *  mensagem executar, então uma mensagem pode enviar outra ao
+ *  próprio objeto mesmo com a fila cheia.
+ *  Uma mensagem cujo execute() retorna true encerra esse lote
+ *  mais cedo. Por padrão a espera é um ParkingWaitStrategy.
  */
 template<class RBWaitStrategy = disruptor::SpinWaitStrategy, int QUEUE_LOG = 5>
-class Active {
+class Active: public CacheAligned {
 public:
 
 	struct Message {
@@ -80,9 +160,9 @@ public:
 
 	Active(bool startNow = true)
 		: m_queue()
-		, m_gatingSequence(new disruptor::Sequence)
+		, m_gatingSequence(m_queue.newSequence())
 		, m_done(false)
-		, m_waitStrategy(new MessageWaitStrategy)
+		, m_waitStrategy(new ParkingWaitStrategy)
 	{
 		m_queue.addGatingSequence(m_gatingSequence);
 		if (startNow) {
@@ -92,7 +172,7 @@ public:
 
     Active(std::shared_ptr<WaitStrategy> waitStrategy, bool startNow = true)
 		: m_queue()
-		, m_gatingSequence(new disruptor::Sequence)
+		, m_gatingSequence(m_queue.newSequence())
 		, m_done(false)
 		, m_waitStrategy(waitStrategy)
 	{
@@ -106,7 +186,15 @@ public:
         m_thread = std::thread(run);
     }
 
+	// for Active(..., false), places the internal thread
+	void start(ThreadFactory& factory) {
+		m_thread = factory.newThread(run);
+	}
+
 	~Active() {
+		if (!m_thread.joinable()) {
+			return; // never started, or start(factory) failed
+		}
 		finish();
         m_thread.join(); // espera para sempre
 	}
@@ -117,7 +205,10 @@ public:
 
 	void send(MsgPtr msg) {
         msg->weakThis = msg;
-		m_queue.publishAndAssign(msg);
+		// moved into the slot, no reference count traffic for the copy
+		m_queue.publishEvent([](MsgPtr& slot, disruptor::seq_t, MsgPtr& m) {
+			slot = std::move(m);
+		}, msg);
 		m_waitStrategy->newData();
 	}
 
@@ -140,19 +231,27 @@ public:
 	MsgPtr& popMessage() {
 		MsgPtr& ptr = consumeMessage();
 		m_gatingSequence->inc();
+		m_queue.signalCapacity();
 		return ptr;
 	}
 
 	bool waitForMessage(int waitMS = -1) const {
 		disruptor::seq_t seq = m_gatingSequence->value() + 1;
+		if (waitMS <= 0) {
+			return m_queue.available(seq);
+		}
 
-		while (waitMS-- > 0) {
-			if (m_queue.available(seq)) {
-				return true;
+		const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(waitMS);
+		for (int i = 0; !m_queue.available(seq); ++i) {
+			if (i < SPIN_TRIES) {
+				SleepUtil::cpuRelax();
+			} else if (std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::yield();
+			} else {
+				return false;
 			}
-			SleepUtil::msleep(1);
 		}
-		return m_queue.available(seq);
+		return true;
 	}
 
 	bool hasAvailableCapacity(int required) {
@@ -173,19 +272,30 @@ private:
     std::shared_ptr<WaitStrategy> m_waitStrategy;
     std::thread m_thread;
 
-    std::function<void()> run = [&](){
-        while (! m_done ) {
+	static const int SPIN_TRIES = 1000;
 
-            while (waitForMessage(0)) {
-                MsgPtr msg = popMessage();
-                if (msg->execute()) {
-                    break;
-                }
-            }
+	std::function<void()> run = [&](){
+		while (!m_done) {
+			const disruptor::seq_t nextSequence = m_gatingSequence->value() + 1;
+			const disruptor::seq_t availableSequence = m_queue.highestPublishedSequence(nextSequence, m_queue.cursorVal());
 
-            m_waitStrategy->wait();
-        }
-    };
+			if (disruptor::sequenceLess(availableSequence, nextSequence)) {
+				m_waitStrategy->waitFor([this, nextSequence]() { return m_queue.available(nextSequence); });
+				continue;
+			}
+
+			for (disruptor::seq_t seq = nextSequence; ; ++seq) {
+				// moved out, so the message is released here and not by the producer that reuses the slot,
+				// and the slot is free before execute() may send to this object
+				MsgPtr msg = std::move(m_queue.preallocated(seq));
+				m_gatingSequence->setOrdered(seq);
+				if (msg->execute() || seq == availableSequence) {
+					break;
+				}
+			}
+			m_queue.signalCapacity();
+		}
+	};
 };
 
 
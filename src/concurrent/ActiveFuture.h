@@ -0,0 +1,202 @@
+#ifndef ACTIVEFUTURE_H
+#define ACTIVEFUTURE_H
+
+#include "Sleep.h"
+#include <exception/Exception.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace detail {
+
+	/* Completion shared by an ActiveFuture and the message that fulfils it
+	 *
+	 * The completing thread only takes the lock when a reader is parked,
+	 * the reader spins a little before it parks.
+	 */
+	class FutureStateBase {
+	public:
+
+		FutureStateBase() : m_state(PENDING), m_parked(false) {}
+
+		// sequentially consistent like complete(), so a parking reader and the completer always see each other
+		bool ready() const {
+			return m_state.load() != PENDING;
+		}
+
+		void wait() {
+			for (int i = 0; i < SPIN_TRIES; ++i) {
+				if (ready()) {
+					return;
+				}
+				SleepUtil::cpuRelax();
+			}
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_parked = true;
+			while (!ready()) {
+				m_condition.wait(lock);
+			}
+		}
+
+		void fail(std::exception_ptr error) {
+			m_error = error;
+			complete(FAILED);
+		}
+
+	protected:
+
+		enum State { PENDING, SUCCEEDED, FAILED };
+
+		static const int SPIN_TRIES = 1000;
+
+		void complete(State state) {
+			m_state.store(state);
+			if (m_parked.load()) {
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_condition.notify_all();
+			}
+		}
+
+		void rethrowIfFailed() {
+			if (m_state.load(std::memory_order_acquire) == FAILED) {
+				std::rethrow_exception(m_error);
+			}
+		}
+
+	private:
+		std::atomic<int> m_state;
+		std::atomic<bool> m_parked;
+		std::exception_ptr m_error;
+		std::mutex m_lock;
+		std::condition_variable m_condition;
+	};
+
+	template<class R>
+	class FutureState: public FutureStateBase {
+	public:
+
+		FutureState() : m_hasValue(false) {}
+
+		~FutureState() {
+			if (m_hasValue) {
+				value().~R();
+			}
+		}
+
+		template<class V>
+		void set(V&& result) {
+			new(&m_storage) R(std::forward<V>(result));
+			m_hasValue = true;
+			complete(SUCCEEDED);
+		}
+
+		R take() {
+			rethrowIfFailed();
+			return std::move(value());
+		}
+
+	private:
+		R& value() {
+			return *reinterpret_cast<R*>(&m_storage);
+		}
+
+		typename std::aligned_storage<sizeof(R), alignof(R)>::type m_storage;
+		bool m_hasValue;
+	};
+
+	template<>
+	class FutureState<void>: public FutureStateBase {
+	public:
+		void set() {
+			complete(SUCCEEDED);
+		}
+
+		void take() {
+			rethrowIfFailed();
+		}
+	};
+
+	// fails a state whose call was destroyed without running
+	inline void breakPromise(FutureStateBase& state) {
+		if (!state.ready()) {
+			state.fail(std::make_exception_ptr(ExceptionLib::InvalidStateException("the call was discarded before it ran")));
+		}
+	}
+
+	// calls f and stores its result or exception in state
+	template<class F>
+	void fulfil(FutureState<void>& state, F& f) {
+		try {
+			f();
+		} catch (...) {
+			state.fail(std::current_exception());
+			return;
+		}
+		state.set();
+	}
+
+	template<class R, class F>
+	void fulfil(FutureState<R>& state, F& f) {
+		try {
+			state.set(f());
+		} catch (...) {
+			state.fail(std::current_exception());
+		}
+	}
+}
+
+/** Result of InlineActive::call, completed on the active thread
+ *
+ *  One allocation for the shared state, no promise/future pair and no
+ *  lock unless get() had to park. get() may be called once, it
+ *  rethrows what the call threw, or InvalidStateException when the
+ *  call was discarded without running. R is never a reference, a call
+ *  that returns one delivers a copy.
+ */
+template<class R>
+class ActiveFuture {
+public:
+
+	ActiveFuture() {}
+
+	explicit ActiveFuture(std::shared_ptr<detail::FutureState<R> > state) : m_state(state) {}
+
+	bool valid() const {
+		return m_state.get() != NULL;
+	}
+
+	bool ready() const {
+		checkValid();
+		return m_state->ready();
+	}
+
+	void wait() const {
+		checkValid();
+		m_state->wait();
+	}
+
+	R get() {
+		checkValid();
+		m_state->wait();
+		std::shared_ptr<detail::FutureState<R> > state;
+		state.swap(m_state);
+		return state->take();
+	}
+
+private:
+	void checkValid() const {
+		if (!valid()) {
+			throw ExceptionLib::InvalidStateException("ActiveFuture has no result");
+		}
+	}
+
+	std::shared_ptr<detail::FutureState<R> > m_state;
+};
+
+#endif // ACTIVEFUTURE_H
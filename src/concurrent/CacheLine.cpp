@@ -0,0 +1,27 @@
+#include "CacheLine.h"
+#include <stdlib.h>
+#include <new>
+
+void* CacheAligned::operator new(size_t size)
+{
+	void* ptr = NULL;
+	if (posix_memalign(&ptr, CONCURRENT_CACHE_LINE_SIZE, size) != 0) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* CacheAligned::operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void CacheAligned::operator delete(void* ptr)
+{
+	free(ptr);
+}
+
+void CacheAligned::operator delete[](void* ptr)
+{
+	free(ptr);
+}
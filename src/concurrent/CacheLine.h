@@ -0,0 +1,37 @@
+#ifndef CACHELINE_H
+#define CACHELINE_H
+
+#include <stddef.h>
+
+/* Granularity used to keep data written by different threads apart.
+ * Configure with -DCONCURRENT_CACHE_LINE_SIZE=128 on targets with
+ * bigger lines or an adjacent line prefetcher.
+ */
+#ifndef CONCURRENT_CACHE_LINE_SIZE
+#define CONCURRENT_CACHE_LINE_SIZE 64
+#endif
+
+/** Base for types declared alignas(CONCURRENT_CACHE_LINE_SIZE)
+ *
+ *  Before C++17 plain new ignores extended alignment, so these
+ *  types bring their own allocation functions.
+ */
+struct CacheAligned {
+
+	static void* operator new(size_t size);
+
+	static void* operator new[](size_t size);
+
+	static void operator delete(void* ptr);
+
+	static void operator delete[](void* ptr);
+
+	// the class specific versions above hide the global placement form
+	static void* operator new(size_t, void* where) {
+		return where;
+	}
+
+	static void operator delete(void*, void*) {}
+};
+
+#endif // CACHELINE_H
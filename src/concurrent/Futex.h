@@ -0,0 +1,41 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#ifdef __linux__
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Thin wrappers over the futex syscall
+ *
+ * The word must be a lock free 32 bit atomic. Pass shared = true when
+ * it lives in memory mapped by several processes.
+ */
+namespace Futex {
+
+	// sleeps while *word == expected, returns early on signals and spurious wake ups
+	inline void wait(std::atomic<int>* word, int expected, bool shared = false) {
+		syscall(SYS_futex, reinterpret_cast<int*>(word), shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+	}
+
+	// as wait, but returns after timeout at the latest
+	inline void waitFor(std::atomic<int>* word, int expected, std::chrono::nanoseconds timeout, bool shared = false) {
+		struct timespec ts;
+		ts.tv_sec = timeout.count() / 1000000000;
+		ts.tv_nsec = timeout.count() % 1000000000;
+		syscall(SYS_futex, reinterpret_cast<int*>(word), shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, expected, &ts, NULL, 0);
+	}
+
+	inline void wake(std::atomic<int>* word, int count = INT_MAX, bool shared = false) {
+		syscall(SYS_futex, reinterpret_cast<int*>(word), shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+	}
+}
+
+#endif // __linux__
+
+#endif // FUTEX_H
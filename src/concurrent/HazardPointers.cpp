@@ -4,6 +4,11 @@
 
 const size_t HPRecord::RetiredLimit = 20;
 
+namespace {
+	// the record of HPRecord::s_threadRecord, without its lookup on every claim
+	thread_local HPRecord* t_threadRecord = NULL;
+}
+
 HPRecord* HPRecord::acquire() {
 
 	HPRecord* p = head();
@@ -40,6 +45,22 @@ HPRecord* HPRecord::acquire() {
 }
 
 
+HPRecord* HPRecord::threadRecord() {
+
+	if (t_threadRecord == NULL) {
+		s_threadRecord.emplaceLocalData();
+		t_threadRecord = s_threadRecord.localData().rec;
+	}
+	return t_threadRecord;
+}
+
+
+HPRecord::ThreadRecord::~ThreadRecord() {
+	rec->releaseRecord();
+	t_threadRecord = NULL;
+}
+
+
 void HPRecord::releasePtr() {
 	hazardPtr = NULL;
 }
@@ -163,3 +184,5 @@ void HPRecord::cleanRecursive(std::atomic<HPRecord*>& rec) {
 }
 
 ThreadStorage<HPRecord::RetiredList> HPRecord::s_rList;
+
+ThreadStorage<HPRecord::ThreadRecord> HPRecord::s_threadRecord;
@@ -25,6 +25,12 @@ public:
 
 	static HPRecord* acquire();
 
+	/* Record owned by the calling thread, acquired on first use and
+	 * returned to the pool when the thread exits. Only for short
+	 * sections that release the pointer before securing another one.
+	 */
+	static HPRecord* threadRecord();
+
 	template<class T>
     static HPRecord* acquire(std::atomic<T*>& stmPtr) {
 		HPRecord* p = acquire();
@@ -88,6 +94,15 @@ private:
 
 	typedef std::deque<RetiredPtrRecord> RetiredList;
 
+	struct ThreadRecord {
+		HPRecord* rec;
+		ThreadRecord() : rec(acquire()) {}
+		~ThreadRecord();
+	private:
+		ThreadRecord(const ThreadRecord&);
+		ThreadRecord& operator=(const ThreadRecord&);
+	};
+
     static std::atomic<HPRecord*>& head();
 
 	static const size_t RetiredLimit;
@@ -96,6 +111,8 @@ private:
 
     static ThreadStorage<RetiredList> s_rList;
 
+    static ThreadStorage<ThreadRecord> s_threadRecord;
+
 	static RetiredList& rList();
 
 	static void Scan(HPRecord* rec);
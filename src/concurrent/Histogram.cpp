@@ -0,0 +1,77 @@
+#include "Histogram.h"
+
+const int Histogram::SUB_BUCKET_BITS;
+const size_t Histogram::SUB_BUCKETS;
+const size_t Histogram::BUCKETS;
+
+Histogram::Histogram()
+{
+	reset();
+}
+
+void Histogram::reset()
+{
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		m_counts[i].store(0, std::memory_order_relaxed);
+	}
+	m_sum.store(0, std::memory_order_relaxed);
+	m_min.store(~uint64_t(0), std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+	Snapshot s;
+	s.m_counts.resize(BUCKETS);
+	s.m_count = 0;
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		s.m_counts[i] = m_counts[i].load(std::memory_order_relaxed);
+		s.m_count += s.m_counts[i];
+	}
+	s.m_sum = m_sum.load(std::memory_order_relaxed);
+	s.m_min = m_min.load(std::memory_order_relaxed);
+	s.m_max = m_max.load(std::memory_order_relaxed);
+	return s;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t index)
+{
+	if (index < SUB_BUCKETS) {
+		return index;
+	}
+	const size_t offset = index - SUB_BUCKETS;
+	const int shift = offset / (SUB_BUCKETS / 2) + 1;
+	const uint64_t top = offset % (SUB_BUCKETS / 2) + SUB_BUCKETS / 2;
+	return ((top + 1) << shift) - 1;
+}
+
+uint64_t Histogram::Snapshot::min() const
+{
+	return m_count == 0 ? 0 : m_min;
+}
+
+double Histogram::Snapshot::mean() const
+{
+	return m_count == 0 ? 0.0 : double(m_sum) / m_count;
+}
+
+uint64_t Histogram::Snapshot::percentile(double percent) const
+{
+	if (m_count == 0) {
+		return 0;
+	}
+	uint64_t rank = static_cast<uint64_t>(percent / 100.0 * m_count + 0.5);
+	if (rank < 1) {
+		rank = 1;
+	}
+	uint64_t seen = 0;
+	for (size_t i = 0; i < m_counts.size(); ++i) {
+		seen += m_counts[i];
+		if (seen >= rank) {
+			// never report more than was actually recorded
+			const uint64_t bound = bucketUpperBound(i);
+			return bound < m_max ? bound : m_max;
+		}
+	}
+	return m_max;
+}
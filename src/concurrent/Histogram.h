@@ -0,0 +1,88 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Log linear histogram of non negative values, after HdrHistogram
+ *
+ *  Values below 64 get a bucket each, above that every power of two
+ *  is split into 32 buckets, so a recorded value is off by less than
+ *  1/32. record() is wait free and may be called from several threads,
+ *  snapshot() can be taken from any thread while recording goes on.
+ */
+class Histogram {
+public:
+
+	static const int SUB_BUCKET_BITS = 6;
+	static const size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+	static const size_t BUCKETS = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * (SUB_BUCKETS / 2);
+
+	Histogram();
+
+	void record(uint64_t value) {
+		m_counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(value, std::memory_order_relaxed);
+
+		uint64_t current = m_min.load(std::memory_order_relaxed);
+		while (value < current && !m_min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+		current = m_max.load(std::memory_order_relaxed);
+		while (value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+	// not atomic with respect to concurrent record() calls
+	void reset();
+
+	class Snapshot {
+	public:
+		uint64_t count() const {
+			return m_count;
+		}
+
+		uint64_t min() const;
+
+		uint64_t max() const {
+			return m_max;
+		}
+
+		double mean() const;
+
+		// smallest bucket bound that percent of the values do not exceed
+		uint64_t percentile(double percent) const;
+
+	private:
+		friend class Histogram;
+		std::vector<uint64_t> m_counts;
+		uint64_t m_count;
+		uint64_t m_sum;
+		uint64_t m_min;
+		uint64_t m_max;
+	};
+
+	Snapshot snapshot() const;
+
+	static size_t bucketIndex(uint64_t value) {
+		if (value < SUB_BUCKETS) {
+			return value;
+		}
+		const int msb = 63 - __builtin_clzll(value);
+		const int shift = msb - SUB_BUCKET_BITS + 1;
+		return SUB_BUCKETS + (shift - 1) * (SUB_BUCKETS / 2) + ((value >> shift) - SUB_BUCKETS / 2);
+	}
+
+	// highest value that falls into the bucket
+	static uint64_t bucketUpperBound(size_t index);
+
+private:
+	Histogram(const Histogram&);
+	Histogram& operator=(const Histogram&);
+
+	std::atomic<uint64_t> m_counts[BUCKETS];
+	std::atomic<uint64_t> m_sum;
+	std::atomic<uint64_t> m_min;
+	std::atomic<uint64_t> m_max;
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,256 @@
+#ifndef INLINEACTIVE_H
+#define INLINEACTIVE_H
+
+#include "Active.h"
+#include "ActiveFuture.h"
+#include "InlineFunction.h"
+#include "ThreadFactory.h"
+#include "disruptor/RingBuffer.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/** Active object whose messages are stored inside the ring
+ *
+ *  Each slot of the ring is an InlineFunction, so send() builds the
+ *  callable directly in its slot. There is no allocation, no reference
+ *  count and no virtual call. Posting a method call is a lambda:
+ *
+ *      account.send([&account, amount]() { account.deposit(amount); });
+ *
+ *  Captures must fit MESSAGE_SIZE bytes, which is checked at compile
+ *  time, and may be move only. They are destroyed on the active thread
+ *  right after the call. The active thread takes every message that is
+ *  available at once. Each message is moved out of its slot and the
+ *  slot freed before the call, so a message may send to its own object
+ *  even when the ring is full. As with Active, an exception thrown by
+ *  a message ends the program.
+ *
+ *  Messages sent after finish() never run. They are destroyed on the
+ *  sending thread when it sees the object done, otherwise when the
+ *  object is destroyed.
+ */
+template<class RBWaitStrategy = disruptor::SpinWaitStrategy, int QUEUE_LOG = 5, size_t MESSAGE_SIZE = 56>
+class InlineActive: public CacheAligned {
+public:
+
+	typedef InlineFunction<MESSAGE_SIZE> Message;
+
+	typedef disruptor::RingBuffer<Message, QUEUE_LOG, RBWaitStrategy, disruptor::MultiProducerSequencer, disruptor::MultiProducerPublisher> RingBuffer_t;
+
+	InlineActive(bool startNow = true)
+		: m_queue()
+		, m_gatingSequence(m_queue.newSequence())
+		, m_done(false)
+		, m_waitStrategy(new ParkingWaitStrategy)
+	{
+		m_queue.addGatingSequence(m_gatingSequence);
+		if (startNow) {
+			start();
+		}
+	}
+
+	InlineActive(std::shared_ptr<WaitStrategy> waitStrategy, bool startNow = true)
+		: m_queue()
+		, m_gatingSequence(m_queue.newSequence())
+		, m_done(false)
+		, m_waitStrategy(waitStrategy)
+	{
+		m_queue.addGatingSequence(m_gatingSequence);
+		if (startNow) {
+			start();
+		}
+	}
+
+	~InlineActive() {
+		if (!m_thread.joinable()) {
+			return;
+		}
+		finish();
+		m_thread.join();
+	}
+
+	void start() {
+		m_thread = std::thread([this]() { run(); });
+	}
+
+	void start(ThreadFactory& factory) {
+		m_thread = factory.newThread([this]() { run(); });
+	}
+
+	// messages sent before are still executed, the ones after are not
+	void finish() {
+		send([this]() { m_done = true; });
+	}
+
+	template<class F>
+	void send(F&& message) {
+		m_queue.publishEvent(Emplace(), std::forward<F>(message));
+		m_waitStrategy->newData();
+		if (m_done.load(std::memory_order_acquire)) {
+			discardPending();
+		}
+	}
+
+	bool done() const {
+		return m_done;
+	}
+
+	/* Runs f(args...) on the active thread, the future gets its result
+	 *
+	 *     ActiveFuture<double> price = book.call(&Book::mid, &book);
+	 *
+	 * The arguments are copied into the message like std::bind does,
+	 * a reference result is copied into the future.
+	 */
+	template<class F, class... Args>
+	auto call(F&& f, Args&&... args)
+			-> ActiveFuture<typename std::decay<decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...)())>::type> {
+		typedef typename std::decay<decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...)())>::type R;
+		std::shared_ptr<detail::FutureState<R> > state = std::make_shared<detail::FutureState<R> >();
+		send(makeCall(state, std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+		return ActiveFuture<R>(state);
+	}
+
+	/* Runs f(args...) on the active thread and sends reply(result) to target
+	 *
+	 *     book.callThen(strategy, [&strategy](double mid) { strategy.onMid(mid); }, &Book::mid, &book);
+	 *
+	 * Nothing waits and nothing is allocated, it costs one message each
+	 * way. target is any active object with send(callable), usually
+	 * another InlineActive. As with send(), f must not throw.
+	 */
+	template<class Target, class Reply, class F, class... Args>
+	void callThen(Target& target, Reply&& reply, F&& f, Args&&... args) {
+		send(makeCallThen(target, std::forward<Reply>(reply), std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+	}
+
+private:
+	InlineActive(const InlineActive&);
+	InlineActive& operator=(const InlineActive&);
+
+	struct Emplace {
+		template<class F>
+		void operator()(Message& slot, disruptor::seq_t, F&& message) const {
+			slot.emplace(std::forward<F>(message));
+		}
+	};
+
+	template<class R, class Bound>
+	struct Call {
+		Call(const std::shared_ptr<detail::FutureState<R> >& s, Bound&& b) : state(s), bound(std::move(b)) {}
+
+		Call(Call&&) = default;
+
+		// a call that never ran, e.g. sent after finish(), must not leave its future waiting
+		~Call() {
+			if (state) {
+				detail::breakPromise(*state);
+			}
+		}
+
+		void operator()() {
+			detail::fulfil(*state, bound);
+		}
+
+		std::shared_ptr<detail::FutureState<R> > state;
+		Bound bound;
+	};
+
+	template<class R, class Bound>
+	static Call<R, Bound> makeCall(const std::shared_ptr<detail::FutureState<R> >& state, Bound&& bound) {
+		return Call<R, Bound>(state, std::move(bound));
+	}
+
+	template<class Target, class Reply, class Bound, class R = typename std::decay<decltype(std::declval<Bound&>()())>::type>
+	struct CallThen {
+		Target* target;
+		Reply reply;
+		Bound bound;
+
+		void operator()() {
+			ReplyWith<R> message = { std::move(reply), bound() };
+			target->send(std::move(message));
+		}
+
+		template<class Result>
+		struct ReplyWith {
+			Reply reply;
+			Result result;
+
+			void operator()() {
+				reply(std::move(result));
+			}
+		};
+	};
+
+	template<class Target, class Reply, class Bound>
+	struct CallThen<Target, Reply, Bound, void> {
+		Target* target;
+		Reply reply;
+		Bound bound;
+
+		void operator()() {
+			bound();
+			target->send(std::move(reply));
+		}
+	};
+
+	template<class Target, class Reply, class Bound>
+	static CallThen<Target, typename std::decay<Reply>::type, Bound> makeCallThen(Target& target, Reply&& reply, Bound&& bound) {
+		CallThen<Target, typename std::decay<Reply>::type, Bound> call = { &target, std::forward<Reply>(reply), std::move(bound) };
+		return call;
+	}
+
+	// destroys the messages nobody is going to run any more
+	void discardPending() {
+		std::lock_guard<std::mutex> lock(m_discardLock);
+		while (true) {
+			const disruptor::seq_t nextSequence = m_gatingSequence->value() + 1;
+			const disruptor::seq_t availableSequence = m_queue.highestPublishedSequence(nextSequence, m_queue.cursorVal());
+			if (disruptor::sequenceLess(availableSequence, nextSequence)) {
+				break;
+			}
+			for (disruptor::seq_t seq = nextSequence; !disruptor::sequenceLess(availableSequence, seq); ++seq) {
+				m_queue.preallocated(seq).reset();
+			}
+			m_gatingSequence->setOrdered(availableSequence);
+			m_queue.signalCapacity();
+		}
+	}
+
+	void run() {
+		while (!m_done) {
+			const disruptor::seq_t nextSequence = m_gatingSequence->value() + 1;
+			const disruptor::seq_t availableSequence = m_queue.highestPublishedSequence(nextSequence, m_queue.cursorVal());
+
+			if (disruptor::sequenceLess(availableSequence, nextSequence)) {
+				m_waitStrategy->waitFor([this, nextSequence]() { return m_queue.available(nextSequence); });
+				continue;
+			}
+
+			// stops right after finish(), the slots behind it stay unconsumed
+			for (disruptor::seq_t seq = nextSequence; !m_done && !disruptor::sequenceLess(availableSequence, seq); ++seq) {
+				Message message(std::move(m_queue.preallocated(seq)));
+				m_gatingSequence->setOrdered(seq);
+				message();
+			}
+			m_queue.signalCapacity();
+		}
+		discardPending();
+	}
+
+	RingBuffer_t m_queue;
+	std::shared_ptr<disruptor::Sequence> m_gatingSequence;
+	std::atomic<bool> m_done;
+	std::mutex m_discardLock;
+	std::shared_ptr<WaitStrategy> m_waitStrategy;
+	std::thread m_thread;
+};
+
+#endif // INLINEACTIVE_H
@@ -0,0 +1,117 @@
+#ifndef INLINEFUNCTION_H
+#define INLINEFUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/** Move only void() callable stored in a fixed buffer
+ *
+ *  Like std::function<void()>, but the callable always lives in the
+ *  SIZE bytes inside the object and never on the heap. A callable
+ *  that does not fit is a compile error, not a hidden allocation.
+ *  The whole object is SIZE bytes plus one pointer, so SIZE = 56 fills
+ *  a 64 byte cache line.
+ */
+template<size_t SIZE>
+class InlineFunction {
+public:
+
+	static const size_t capacity = SIZE;
+
+	InlineFunction() : m_ops(NULL) {}
+
+	template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+	InlineFunction(F&& f) : m_ops(NULL) {
+		emplace(std::forward<F>(f));
+	}
+
+	InlineFunction(InlineFunction&& that) : m_ops(NULL) {
+		*this = std::move(that);
+	}
+
+	InlineFunction& operator=(InlineFunction&& that) {
+		if (this != &that) {
+			reset();
+			if (that.m_ops != NULL) {
+				that.m_ops->move(that.m_storage, m_storage);
+				m_ops = that.m_ops;
+				that.m_ops = NULL;
+			}
+		}
+		return *this;
+	}
+
+	~InlineFunction() {
+		reset();
+	}
+
+	// replaces the callable with a copy or move of f
+	template<class F>
+	void emplace(F&& f) {
+		typedef typename std::decay<F>::type Callable;
+		static_assert(sizeof(Callable) <= SIZE, "callable does not fit the inline buffer");
+		static_assert(alignof(Callable) <= alignof(std::max_align_t), "callable is over aligned");
+		reset();
+		new(m_storage) Callable(std::forward<F>(f));
+		m_ops = &Ops<Callable>::table;
+	}
+
+	// destroys the callable in place
+	void reset() {
+		if (m_ops != NULL) {
+			m_ops->destroy(m_storage);
+			m_ops = NULL;
+		}
+	}
+
+	void operator()() {
+		m_ops->invoke(m_storage);
+	}
+
+	explicit operator bool() const {
+		return m_ops != NULL;
+	}
+
+private:
+	InlineFunction(const InlineFunction&);
+	InlineFunction& operator=(const InlineFunction&);
+
+	struct Table {
+		void (*invoke)(void*);
+		void (*move)(void* from, void* to);
+		void (*destroy)(void*);
+	};
+
+	template<class Callable>
+	struct Ops {
+		static void invoke(void* f) {
+			(*static_cast<Callable*>(f))();
+		}
+
+		static void move(void* from, void* to) {
+			new(to) Callable(std::move(*static_cast<Callable*>(from)));
+			static_cast<Callable*>(from)->~Callable();
+		}
+
+		static void destroy(void* f) {
+			static_cast<Callable*>(f)->~Callable();
+		}
+
+		static const Table table;
+	};
+
+	alignas(std::max_align_t) unsigned char m_storage[SIZE];
+	const Table* m_ops;
+};
+
+template<size_t SIZE>
+template<class Callable>
+const typename InlineFunction<SIZE>::Table InlineFunction<SIZE>::Ops<Callable>::table = {
+	&InlineFunction<SIZE>::Ops<Callable>::invoke,
+	&InlineFunction<SIZE>::Ops<Callable>::move,
+	&InlineFunction<SIZE>::Ops<Callable>::destroy
+};
+
+#endif // INLINEFUNCTION_H
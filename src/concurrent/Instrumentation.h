@@ -0,0 +1,29 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include "Histogram.h"
+#include <chrono>
+#include <stdint.h>
+
+/* Opt in latency instrumentation
+ *
+ * Configure with -DCONCURRENT_INSTRUMENTATION=ON and the rings stamp
+ * every slot they publish, while BatchEventProcessor and EventPoller
+ * record into their ConsumerStats. Without the definition none of it
+ * is compiled in and the event path is unchanged.
+ */
+namespace Instrumentation {
+
+	// monotonic nanoseconds, comparable between threads
+	inline uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+struct ConsumerStats {
+	Histogram latencyNS;  //!< publish to handler call, per event
+	Histogram batchSize;  //!< events handed over per wake up
+	Histogram queueDepth; //!< claimed but not yet consumed events at each wake up
+};
+
+#endif // INSTRUMENTATION_H
@@ -0,0 +1,408 @@
+#include "Journal.h"
+
+#include <exception/Exception.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace ExceptionLib;
+
+namespace {
+
+	struct SegmentHeader {
+		static const uint32_t MAGIC = 0x4a524e4c;
+		static const uint32_t VERSION = 2;
+
+		uint32_t magic;
+		uint32_t version;
+		uint64_t recordSize;
+		uint64_t firstSequence;
+		uint64_t capacity;
+	};
+
+	// records start on their own cache line after the header
+	const size_t HEADER_SIZE = 64;
+
+	/* every record is prefixed by its sequence + 1, zero marks a free slot,
+	 * and by the CRC-32C of that marker and the record
+	 */
+	const size_t MARKER_SIZE = sizeof(uint64_t);
+	const size_t CHECKSUM_OFFSET = MARKER_SIZE;
+	const size_t PREFIX_SIZE = 16;
+
+	size_t recordStride(size_t recordSize) {
+		return (PREFIX_SIZE + recordSize + 7) / 8 * 8;
+	}
+
+	struct Crc32cTable {
+		uint32_t entries[256];
+
+		Crc32cTable() {
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; ++bit) {
+					crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+				}
+				entries[i] = crc;
+			}
+		}
+	};
+
+	uint32_t crc32c(uint32_t crc, const void* data, size_t size) {
+		static const Crc32cTable table;
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			crc = table.entries[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+	uint32_t recordChecksum(uint64_t marker, const void* record, size_t recordSize) {
+		return ~crc32c(crc32c(~0u, &marker, sizeof(marker)), record, recordSize);
+	}
+
+	std::string systemError(const char* call, const std::string& path) {
+		return std::string(call) + "(" + path + ") failed: " + strerror(errno);
+	}
+
+	std::string segmentPath(const std::string& directory, uint64_t firstSequence) {
+		char name[64];
+		snprintf(name, sizeof(name), "/journal-%020llu.seg", static_cast<unsigned long long>(firstSequence));
+		return directory + name;
+	}
+
+	// segment file names sorted by first sequence
+	std::vector<std::string> listSegments(const std::string& directory) {
+		std::vector<std::string> segments;
+		DIR* dir = opendir(directory.c_str());
+		if (dir == NULL) {
+			throw Exception(systemError("opendir", directory));
+		}
+		while (struct dirent* entry = readdir(dir)) {
+			const std::string name = entry->d_name;
+			if (name.size() > 12 && name.compare(0, 8, "journal-") == 0 && name.compare(name.size() - 4, 4, ".seg") == 0) {
+				segments.push_back(directory + "/" + name);
+			}
+		}
+		closedir(dir);
+		std::sort(segments.begin(), segments.end());
+		return segments;
+	}
+
+	uint64_t marker(const char* data, size_t stride, size_t position) {
+		return *reinterpret_cast<const uint64_t*>(data + HEADER_SIZE + position * stride);
+	}
+
+	// the record at position holds sequence and is not torn
+	bool intact(const char* data, size_t stride, size_t recordSize, size_t position, uint64_t sequence) {
+		const char* slot = data + HEADER_SIZE + position * stride;
+		return *reinterpret_cast<const uint64_t*>(slot) == sequence + 1
+			&& *reinterpret_cast<const uint32_t*>(slot + CHECKSUM_OFFSET) == recordChecksum(sequence + 1, slot + PREFIX_SIZE, recordSize);
+	}
+}
+
+
+JournalWriter::JournalWriter(const std::string& directory, size_t recordSize, const JournalOptions& options)
+	: m_directory(directory)
+	, m_recordSize(recordSize)
+	, m_stride(recordStride(recordSize))
+	, m_options(options)
+	, m_fd(-1)
+	, m_data(NULL)
+	, m_mappingSize(0)
+	, m_capacity(0)
+	, m_position(0)
+	, m_syncedPosition(0)
+	, m_nextSequence(0)
+{
+	if (options.segmentSize < HEADER_SIZE + m_stride) {
+		throw ProgrammingError("the journal segment size must hold at least one record");
+	}
+
+	const std::vector<std::string> segments = listSegments(directory);
+	if (segments.empty()) {
+		return;
+	}
+
+	// continue after the last intact record of the newest segment
+	openSegment(segments.back(), false);
+	const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(m_data);
+	if (header->magic != SegmentHeader::MAGIC || header->version != SegmentHeader::VERSION || header->recordSize != recordSize) {
+		closeSegment();
+		throw Exception(segments.back() + " is not a journal segment of this record size");
+	}
+	m_capacity = std::min<size_t>(header->capacity, (m_mappingSize - HEADER_SIZE) / m_stride);
+	uint64_t sequence = header->firstSequence;
+	while (m_position < m_capacity && intact(m_data, m_stride, m_recordSize, m_position, sequence)) {
+		++m_position;
+		++sequence;
+	}
+	m_nextSequence.store(sequence, std::memory_order_release);
+
+	// a crash may have left records of a torn batch behind the gap, they must not
+	// be taken for the ones written from now on
+	bool cleared = false;
+	for (size_t i = m_position; i < m_capacity; ++i) {
+		if (marker(m_data, m_stride, i) != 0) {
+			*reinterpret_cast<uint64_t*>(m_data + HEADER_SIZE + i * m_stride) = 0;
+			cleared = true;
+		}
+	}
+	if (cleared && msync(m_data, m_mappingSize, MS_SYNC) != 0) {
+		const std::string msg = systemError("msync", segments.back());
+		closeSegment();
+		throw Exception(msg);
+	}
+	m_syncedPosition = m_position;
+}
+
+JournalWriter::~JournalWriter()
+{
+	try {
+		sync();
+	} catch (...) {
+		// nothing left to report the failure to
+	}
+	closeSegment();
+}
+
+void JournalWriter::append(uint64_t sequence, const void* record)
+{
+	if (sequence != m_nextSequence.load(std::memory_order_relaxed)) {
+		throw ProgrammingError("journal sequences must be contiguous");
+	}
+	if (m_position == m_capacity) {
+		roll();
+	}
+
+	char* slot = m_data + HEADER_SIZE + m_position * m_stride;
+	memcpy(slot + PREFIX_SIZE, record, m_recordSize);
+	*reinterpret_cast<uint32_t*>(slot + CHECKSUM_OFFSET) = recordChecksum(sequence + 1, slot + PREFIX_SIZE, m_recordSize);
+	*reinterpret_cast<uint64_t*>(slot) = sequence + 1;
+
+	++m_position;
+	m_nextSequence.store(sequence + 1, std::memory_order_release);
+}
+
+void JournalWriter::sync()
+{
+	if (m_data == NULL || m_position == m_syncedPosition) {
+		return;
+	}
+
+	switch (m_options.sync) {
+	case JournalOptions::NO_SYNC:
+		break;
+	case JournalOptions::MSYNC_ASYNC:
+	case JournalOptions::MSYNC: {
+		// msync wants a page aligned start
+		const size_t pageSize = sysconf(_SC_PAGESIZE);
+		const size_t begin = (HEADER_SIZE + m_syncedPosition * m_stride) / pageSize * pageSize;
+		const size_t end = HEADER_SIZE + m_position * m_stride;
+		if (msync(m_data + begin, end - begin, m_options.sync == JournalOptions::MSYNC ? MS_SYNC : MS_ASYNC) != 0) {
+			throw Exception(systemError("msync", m_directory));
+		}
+		break;
+	}
+	case JournalOptions::FDATASYNC:
+		if (fdatasync(m_fd) != 0) {
+			throw Exception(systemError("fdatasync", m_directory));
+		}
+		break;
+	}
+	m_syncedPosition = m_position;
+}
+
+void JournalWriter::openSegment(const std::string& path, bool create)
+{
+	// a created segment is a temporary file, a crash may have left one behind
+	m_fd = open(path.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+	if (m_fd < 0) {
+		throw Exception(systemError("open", path));
+	}
+
+	if (create) {
+		m_mappingSize = HEADER_SIZE + (m_options.segmentSize - HEADER_SIZE) / m_stride * m_stride;
+		if (ftruncate(m_fd, m_mappingSize) != 0) {
+			const std::string msg = systemError("ftruncate", path);
+			close(m_fd);
+			m_fd = -1;
+			throw Exception(msg);
+		}
+	} else {
+		struct stat st;
+		if (fstat(m_fd, &st) != 0 || size_t(st.st_size) < HEADER_SIZE) {
+			close(m_fd);
+			m_fd = -1;
+			throw Exception(path + " is not a journal segment");
+		}
+		m_mappingSize = st.st_size;
+	}
+
+	void* data = mmap(NULL, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (data == MAP_FAILED) {
+		const std::string msg = systemError("mmap", path);
+		close(m_fd);
+		m_fd = -1;
+		throw Exception(msg);
+	}
+	m_data = static_cast<char*>(data);
+	m_position = 0;
+	m_syncedPosition = 0;
+}
+
+void JournalWriter::closeSegment()
+{
+	if (m_data != NULL) {
+		munmap(m_data, m_mappingSize);
+		m_data = NULL;
+	}
+	if (m_fd >= 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+void JournalWriter::roll()
+{
+	sync();
+	closeSegment();
+
+	const uint64_t firstSequence = m_nextSequence.load(std::memory_order_relaxed);
+	const std::string path = segmentPath(m_directory, firstSequence);
+
+	/* built under a name the journal ignores and renamed once the header is
+	 * on disk, so a crash never leaves a segment without a header behind
+	 */
+	const std::string temporary = path + ".tmp";
+	// a failed roll leaves no segment, the next append tries again
+	m_capacity = 0;
+	m_position = 0;
+	openSegment(temporary, true);
+
+	SegmentHeader* header = reinterpret_cast<SegmentHeader*>(m_data);
+	header->magic = SegmentHeader::MAGIC;
+	header->version = SegmentHeader::VERSION;
+	header->recordSize = m_recordSize;
+	header->firstSequence = firstSequence;
+	header->capacity = (m_mappingSize - HEADER_SIZE) / m_stride;
+
+	const bool durable = m_options.sync != JournalOptions::NO_SYNC;
+	if (durable && msync(m_data, HEADER_SIZE, MS_SYNC) != 0) {
+		failRoll(temporary, "msync");
+	}
+	if (rename(temporary.c_str(), path.c_str()) != 0) {
+		failRoll(temporary, "rename");
+	}
+	if (durable) {
+		const int dir = open(m_directory.c_str(), O_RDONLY | O_DIRECTORY);
+		if (dir < 0 || fsync(dir) != 0) {
+			const std::string msg = systemError("fsync", m_directory);
+			if (dir >= 0) {
+				close(dir);
+			}
+			closeSegment();
+			throw Exception(msg);
+		}
+		close(dir);
+	}
+	m_capacity = header->capacity;
+}
+
+void JournalWriter::failRoll(const std::string& temporary, const char* call)
+{
+	const std::string msg = systemError(call, temporary);
+	closeSegment();
+	unlink(temporary.c_str());
+	throw Exception(msg);
+}
+
+
+JournalReader::JournalReader(const std::string& directory, size_t recordSize)
+	: m_recordSize(recordSize)
+	, m_stride(recordStride(recordSize))
+	, m_segments(listSegments(directory))
+	, m_segment(0)
+	, m_data(NULL)
+	, m_capacity(0)
+	, m_position(0)
+	, m_sequence(0)
+	, m_expected(0)
+	, m_finished(false)
+{
+}
+
+JournalReader::~JournalReader()
+{
+	for (size_t i = 0; i < m_mappings.size(); ++i) {
+		munmap(m_mappings[i].first, m_mappings[i].second);
+	}
+}
+
+const void* JournalReader::next()
+{
+	if (m_finished) {
+		return NULL;
+	}
+
+	if (m_data == NULL || m_position == m_capacity) {
+		const size_t index = m_data == NULL ? 0 : m_segment + 1;
+		if (index >= m_segments.size() || !openSegment(index)) {
+			m_finished = true;
+			return NULL;
+		}
+	}
+
+	if (!intact(m_data, m_stride, m_recordSize, m_position, m_expected)) {
+		m_finished = true;
+		return NULL;
+	}
+
+	const char* record = m_data + HEADER_SIZE + m_position * m_stride + PREFIX_SIZE;
+	m_sequence = m_expected;
+	++m_expected;
+	++m_position;
+	return record;
+}
+
+bool JournalReader::openSegment(size_t index)
+{
+	const std::string& path = m_segments[index];
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw Exception(systemError("open", path));
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || size_t(st.st_size) < HEADER_SIZE) {
+		close(fd);
+		return false;
+	}
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		throw Exception(systemError("mmap", path));
+	}
+	m_mappings.push_back(std::make_pair(data, size_t(st.st_size)));
+
+	const SegmentHeader* header = static_cast<const SegmentHeader*>(data);
+	if (header->magic != SegmentHeader::MAGIC || header->version != SegmentHeader::VERSION || header->recordSize != m_recordSize) {
+		throw Exception(path + " is not a journal segment of this record size");
+	}
+	if (index == 0) {
+		m_expected = header->firstSequence;
+	} else if (header->firstSequence != m_expected) {
+		return false;
+	}
+
+	m_data = static_cast<const char*>(data);
+	m_segment = index;
+	m_capacity = std::min<size_t>(header->capacity, (st.st_size - HEADER_SIZE) / m_stride);
+	m_position = 0;
+	return true;
+}
@@ -0,0 +1,124 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct JournalOptions {
+
+	enum Sync {
+		NO_SYNC,     //!< leave write back to the kernel, survives process crashes only
+		MSYNC_ASYNC, //!< msync(MS_ASYNC), schedules the write back and returns
+		MSYNC,       //!< msync(MS_SYNC) of the pages written since the last sync
+		FDATASYNC    //!< fdatasync of the whole segment file
+	};
+
+	JournalOptions()
+		: segmentSize(64*1024*1024)
+		, sync(MSYNC)
+	{}
+
+	size_t segmentSize; //!< bytes per segment file, rounded down to whole records
+	Sync sync;
+};
+
+/** Appends fixed size records to memory mapped segment files
+ *
+ *  Segments are named journal-<first sequence>.seg and hold a small
+ *  header followed by records that carry their sequence and a CRC-32C
+ *  of sequence and contents, so a record torn by a crash is detected
+ *  wherever the sync points fall. Records are
+ *  copied straight into the mapping, sync() makes everything appended
+ *  so far durable according to JournalOptions::sync.
+ *
+ *  Opening a directory that already holds a journal continues after
+ *  its last intact record, see nextSequence().
+ */
+class JournalWriter {
+public:
+
+	JournalWriter(const std::string& directory, size_t recordSize, const JournalOptions& options = JournalOptions());
+
+	// syncs and unmaps the current segment
+	~JournalWriter();
+
+	// sequences must be contiguous, starting at nextSequence()
+	void append(uint64_t sequence, const void* record);
+
+	void sync();
+
+	// may be read by other threads, everything below it is appended
+	uint64_t nextSequence() const {
+		return m_nextSequence.load(std::memory_order_acquire);
+	}
+
+private:
+	JournalWriter(const JournalWriter&);
+	JournalWriter& operator=(const JournalWriter&);
+
+	void openSegment(const std::string& path, bool create);
+	void closeSegment();
+	void roll();
+	// removes the half built segment and throws
+	void failRoll(const std::string& temporary, const char* call);
+
+	const std::string m_directory;
+	const size_t m_recordSize;
+	const size_t m_stride;
+	const JournalOptions m_options;
+
+	int m_fd;
+	char* m_data;
+	size_t m_mappingSize;
+	size_t m_capacity;       // records per segment
+	size_t m_position;       // next free record of the segment
+	size_t m_syncedPosition;
+	std::atomic<uint64_t> m_nextSequence;
+};
+
+/** Reads the intact records of a journal in sequence order
+ *
+ *  Stops at the first record that does not continue the sequence or
+ *  fails its checksum, which is where a crash cut off the last
+ *  unsynced batch.
+ */
+class JournalReader {
+public:
+
+	JournalReader(const std::string& directory, size_t recordSize);
+
+	~JournalReader();
+
+	// next record or NULL after the last one, valid as long as the reader
+	const void* next();
+
+	uint64_t sequence() const {
+		return m_sequence;
+	}
+
+private:
+	JournalReader(const JournalReader&);
+	JournalReader& operator=(const JournalReader&);
+
+	bool openSegment(size_t index);
+
+	const size_t m_recordSize;
+	const size_t m_stride;
+	std::vector<std::string> m_segments;
+	size_t m_segment;
+
+	// every segment read so far stays mapped
+	std::vector<std::pair<void*, size_t> > m_mappings;
+	const char* m_data;
+	size_t m_capacity;
+	size_t m_position;
+	uint64_t m_sequence;
+	uint64_t m_expected;
+	bool m_finished;
+};
+
+#endif // JOURNAL_H
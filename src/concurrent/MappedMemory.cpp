@@ -0,0 +1,118 @@
+#include "MappedMemory.h"
+#include "Numa.h"
+
+#include <exception/Exception.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+
+using namespace ExceptionLib;
+
+namespace {
+
+	size_t roundUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	int log2(size_t powerOfTwo) {
+		int shift = 0;
+		while ((size_t(1) << shift) < powerOfTwo) {
+			++shift;
+		}
+		return shift;
+	}
+
+	std::string systemError(const char* call) {
+		return std::string(call) + " failed: " + strerror(errno);
+	}
+}
+
+MappedMemory::MappedMemory(size_t size, const MemoryOptions& options)
+	: m_mapping(MAP_FAILED)
+	, m_mappingSize(0)
+	, m_data(NULL)
+	, m_size(size)
+	, m_locked(false)
+{
+	const size_t pageSize = sysconf(_SC_PAGESIZE);
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+	if (options.hugePages != MemoryOptions::NO_HUGE_PAGES && (options.hugePageSize == 0 || (options.hugePageSize & (options.hugePageSize - 1)) != 0)) {
+		throw ProgrammingError("huge page size must be a power of two");
+	}
+
+	switch (options.hugePages) {
+	case MemoryOptions::NO_HUGE_PAGES:
+		m_mappingSize = roundUp(size, pageSize);
+		break;
+	case MemoryOptions::TRANSPARENT_HUGE_PAGES:
+		// one extra huge page so that the start can be aligned to a huge page boundary
+		m_mappingSize = roundUp(size, options.hugePageSize) + options.hugePageSize;
+		break;
+	case MemoryOptions::EXPLICIT_HUGE_PAGES:
+#ifdef MAP_HUGETLB
+		m_mappingSize = roundUp(size, options.hugePageSize);
+		flags |= MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+		// from the pool of this size, not the default one
+		flags |= log2(options.hugePageSize) << MAP_HUGE_SHIFT;
+#endif
+		break;
+#else
+		throw Exception("explicit huge pages are not supported on this platform");
+#endif
+	}
+
+	m_mapping = mmap(NULL, m_mappingSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (m_mapping == MAP_FAILED) {
+		throw Exception(systemError("mmap"));
+	}
+	m_data = m_mapping;
+
+	if (options.hugePages == MemoryOptions::TRANSPARENT_HUGE_PAGES) {
+		const uintptr_t start = reinterpret_cast<uintptr_t>(m_mapping);
+		m_data = reinterpret_cast<void*>(roundUp(start, options.hugePageSize));
+#ifdef MADV_HUGEPAGE
+		// best effort, the kernel may have THP disabled
+		madvise(m_data, roundUp(size, options.hugePageSize), MADV_HUGEPAGE);
+#endif
+	}
+
+	// before anything touches the pages
+	if (options.numaNode >= 0) {
+		try {
+			Numa::preferNode(m_mapping, m_mappingSize, options.numaNode);
+		} catch (...) {
+			munmap(m_mapping, m_mappingSize);
+			throw;
+		}
+	}
+
+	if (options.prefault) {
+		// small page steps, transparent huge pages may not have been granted
+		volatile char* bytes = static_cast<char*>(m_data);
+		for (size_t offset = 0; offset < size; offset += pageSize) {
+			bytes[offset] = 0;
+		}
+	}
+
+	if (options.lock) {
+		if (mlock(m_data, size) != 0) {
+			const std::string msg = systemError("mlock");
+			munmap(m_mapping, m_mappingSize);
+			throw Exception(msg);
+		}
+		m_locked = true;
+	}
+}
+
+MappedMemory::~MappedMemory()
+{
+	if (m_locked) {
+		munlock(m_data, m_size);
+	}
+	munmap(m_mapping, m_mappingSize);
+}
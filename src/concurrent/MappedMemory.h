@@ -0,0 +1,61 @@
+#ifndef MAPPEDMEMORY_H
+#define MAPPEDMEMORY_H
+
+#include <stddef.h>
+
+struct MemoryOptions {
+
+	enum HugePages {
+		NO_HUGE_PAGES,
+		TRANSPARENT_HUGE_PAGES, //!< madvise(MADV_HUGEPAGE) on a huge page aligned region
+		EXPLICIT_HUGE_PAGES     //!< MAP_HUGETLB, needs pages reserved in vm.nr_hugepages
+	};
+
+	MemoryOptions()
+		: hugePages(NO_HUGE_PAGES)
+		, hugePageSize(2*1024*1024)
+		, prefault(false)
+		, lock(false)
+		, numaNode(-1)
+	{}
+
+	HugePages hugePages;
+	size_t hugePageSize; //!< a power of two, explicit huge pages come from the pool of this size
+	bool prefault; //!< touch every page up front so the first lap takes no page faults
+	bool lock;     //!< mlock the region, subject to RLIMIT_MEMLOCK
+	int numaNode;  //!< preferred node for the pages, -1 leaves it to the first touch
+};
+
+/** One anonymous, page aligned mapping
+ *
+ *  Large preallocated structures like ring buffers live here instead
+ *  of on the heap, so they can be backed by huge pages and be faulted
+ *  in and pinned before the threads that use them start.
+ */
+class MappedMemory {
+public:
+
+	MappedMemory(size_t size, const MemoryOptions& options = MemoryOptions());
+
+	~MappedMemory();
+
+	void* data() const {
+		return m_data;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+private:
+	MappedMemory(const MappedMemory&);
+	MappedMemory& operator=(const MappedMemory&);
+
+	void* m_mapping;
+	size_t m_mappingSize;
+	void* m_data;
+	size_t m_size;
+	bool m_locked;
+};
+
+#endif // MAPPEDMEMORY_H
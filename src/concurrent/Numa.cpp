@@ -0,0 +1,67 @@
+#include "Numa.h"
+
+#include <exception/Exception.h>
+#include <errno.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace ExceptionLib;
+
+namespace {
+
+	std::string systemError(const char* call) {
+		return std::string(call) + " failed: " + strerror(errno);
+	}
+
+	const size_t BITS_PER_LONG = 8 * sizeof(unsigned long);
+
+	std::vector<unsigned long> nodeMask(int node) {
+		if (node < 0) {
+			throw Exception("NUMA node must not be negative");
+		}
+		std::vector<unsigned long> mask(node / BITS_PER_LONG + 1, 0);
+		mask[node / BITS_PER_LONG] |= 1UL << (node % BITS_PER_LONG);
+		return mask;
+	}
+}
+
+#ifdef __linux__
+
+// the kernel drops the last bit of maxnode, hence the + 1 as in libnuma
+
+void Numa::preferNode(void* data, size_t size, int node)
+{
+	const std::vector<unsigned long> mask = nodeMask(node);
+	if (syscall(SYS_mbind, data, size, MPOL_PREFERRED, &mask[0], mask.size() * BITS_PER_LONG + 1, 0) != 0) {
+		throw Exception(systemError("mbind"));
+	}
+}
+
+void Numa::preferNodeForThread(int node)
+{
+	const std::vector<unsigned long> mask = nodeMask(node);
+	if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask[0], mask.size() * BITS_PER_LONG + 1) != 0) {
+		throw Exception(systemError("set_mempolicy"));
+	}
+}
+
+#else
+
+void Numa::preferNode(void*, size_t, int)
+{
+	throw Exception("NUMA placement is not supported on this platform");
+}
+
+void Numa::preferNodeForThread(int)
+{
+	throw Exception("NUMA placement is not supported on this platform");
+}
+
+#endif
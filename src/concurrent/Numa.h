@@ -0,0 +1,22 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+
+/* NUMA placement without libnuma
+ *
+ * Both set a preferred node: pages come from that node while it has
+ * free memory and from the nearest other node after that. Only pages
+ * faulted in afterwards are placed, pages already present stay where
+ * they are. Throw where the kernel has no NUMA support.
+ */
+namespace Numa {
+
+	// policy for the pages of [data, data + size), data must be page aligned
+	void preferNode(void* data, size_t size, int node);
+
+	// policy for everything the calling thread allocates from now on
+	void preferNodeForThread(int node);
+}
+
+#endif // NUMA_H
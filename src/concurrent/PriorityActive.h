@@ -0,0 +1,232 @@
+#ifndef PRIORITYACTIVE_H
+#define PRIORITYACTIVE_H
+
+#include "Active.h"
+#include "ThreadFactory.h"
+#include "disruptor/RingBuffer.h"
+
+#include <exception/Exception.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+
+/** Active object with one ring per priority lane
+ *
+ *  Lane 0 has the highest priority. The active thread always drains the
+ *  highest lane that has messages, one batch of at most batchLimit
+ *  messages at a time, so a control message waits for one batch and not
+ *  for everything queued before it:
+ *
+ *      active.send(MsgPtr(new CancelMessage(order)), 0);
+ *
+ *  A lane that has messages but was passed over starvationLimit times
+ *  in a row gets the next batch, so the low lanes always progress.
+ *  Every lane keeps the lock free publish path of Active and the
+ *  messages are the same Active<...>::Message objects. Within a lane
+ *  the order is FIFO, across lanes there is no order.
+ *
+ *  As with Active, messages published after the finish message ran
+ *  never run, so producers that keep sending cannot hold the thread.
+ */
+template<class RBWaitStrategy = disruptor::SpinWaitStrategy, int LANES = 2, int QUEUE_LOG = 5>
+class PriorityActive: public CacheAligned {
+public:
+
+	static_assert(LANES > 0, "at least one lane");
+
+	typedef typename Active<RBWaitStrategy, QUEUE_LOG>::Message Message;
+
+	typedef std::shared_ptr<Message> MsgPtr;
+
+	typedef disruptor::RingBuffer<MsgPtr, QUEUE_LOG, RBWaitStrategy, disruptor::MultiProducerSequencer, disruptor::MultiProducerPublisher> RingBuffer_t;
+
+	PriorityActive(bool startNow = true, size_t starvationLimit = 8, size_t batchLimit = 64)
+		: m_starvationLimit(starvationLimit)
+		, m_batchLimit(batchLimit)
+		, m_finishing(false)
+		, m_finishSent(false)
+		, m_done(false)
+		, m_waitStrategy(new ParkingWaitStrategy)
+	{
+		init(startNow);
+	}
+
+	PriorityActive(std::shared_ptr<WaitStrategy> waitStrategy, bool startNow = true, size_t starvationLimit = 8, size_t batchLimit = 64)
+		: m_starvationLimit(starvationLimit)
+		, m_batchLimit(batchLimit)
+		, m_finishing(false)
+		, m_finishSent(false)
+		, m_done(false)
+		, m_waitStrategy(waitStrategy)
+	{
+		init(startNow);
+	}
+
+	~PriorityActive() {
+		if (!m_thread.joinable()) {
+			return;
+		}
+		finish();
+		m_thread.join();
+	}
+
+	void start() {
+		m_thread = std::thread([this]() { run(); });
+	}
+
+	void start(ThreadFactory& factory) {
+		m_thread = factory.newThread([this]() { run(); });
+	}
+
+	/* the thread stops once it ran what every lane held when the finish
+	 * message ran, later messages are dropped; only the first call sends it
+	 */
+	void finish() {
+		if (!m_finishSent.exchange(true)) {
+			send(MsgPtr(new FinishMessage(this)), LANES - 1);
+		}
+	}
+
+	// lane 0 is the most urgent, by default messages go to the last lane
+	void send(MsgPtr msg, int lane = LANES - 1) {
+		if (lane < 0 || lane >= LANES) {
+			throw ExceptionLib::ProgrammingError("PriorityActive lane out of range");
+		}
+		msg->weakThis = msg;
+		m_lanes[lane].ring.publishEvent([](MsgPtr& slot, disruptor::seq_t, MsgPtr& m) {
+			slot = std::move(m);
+		}, msg);
+		m_waitStrategy->newData();
+	}
+
+	bool hasAvailableCapacity(int required, int lane = LANES - 1) {
+		return m_lanes[lane].ring.hasAvailableCapacity(required);
+	}
+
+	bool done() const {
+		return m_done;
+	}
+
+private:
+	PriorityActive(const PriorityActive&);
+	PriorityActive& operator=(const PriorityActive&);
+
+	struct Lane {
+		RingBuffer_t ring;
+		std::shared_ptr<disruptor::Sequence> gatingSequence;
+		size_t passedOver;
+		disruptor::seq_t finishAt; // the last message that runs once finishing
+
+		bool hasMessages(bool finishing) const {
+			const disruptor::seq_t next = gatingSequence->value() + 1;
+			if (finishing && disruptor::sequenceLess(finishAt, next)) {
+				return false;
+			}
+			return ring.available(next);
+		}
+	};
+
+	struct FinishMessage: public Message {
+		FinishMessage(PriorityActive* a) : m_active(a) {}
+		virtual bool execute() { m_active->beginFinishing(); return true; }
+		PriorityActive* m_active;
+	};
+
+	void beginFinishing() {
+		for (int l = 0; l < LANES; ++l) {
+			Lane& lane = m_lanes[l];
+			lane.finishAt = lane.ring.highestPublishedSequence(lane.gatingSequence->value() + 1, lane.ring.cursorVal());
+		}
+		m_finishing = true;
+	}
+
+	void init(bool startNow) {
+		if (m_batchLimit == 0) {
+			throw ExceptionLib::ProgrammingError("PriorityActive batch limit must be greater than 0");
+		}
+		for (int l = 0; l < LANES; ++l) {
+			Lane& lane = m_lanes[l];
+			lane.gatingSequence = lane.ring.newSequence();
+			lane.ring.addGatingSequence(lane.gatingSequence);
+			lane.passedOver = 0;
+			lane.finishAt = disruptor::Sequence::INITIAL_CURSOR_VALUE;
+		}
+		if (startNow) {
+			start();
+		}
+	}
+
+	bool hasMessages() const {
+		for (int l = 0; l < LANES; ++l) {
+			if (m_lanes[l].hasMessages(m_finishing)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// highest lane with messages, unless a lower one was passed over too often
+	int nextLane() {
+		int chosen = -1;
+		for (int l = 0; l < LANES; ++l) {
+			Lane& lane = m_lanes[l];
+			if (!lane.hasMessages(m_finishing)) {
+				lane.passedOver = 0;
+			} else if (chosen < 0) {
+				chosen = l;
+			} else if (lane.passedOver++ >= m_starvationLimit) {
+				lane.passedOver = 0;
+				return l;
+			}
+		}
+		return chosen;
+	}
+
+	void drain(Lane& lane) {
+		const disruptor::seq_t nextSequence = lane.gatingSequence->value() + 1;
+		disruptor::seq_t availableSequence = lane.ring.highestPublishedSequence(nextSequence, lane.ring.cursorVal());
+		if (availableSequence - nextSequence >= m_batchLimit) {
+			availableSequence = nextSequence + m_batchLimit - 1;
+		}
+		if (m_finishing && disruptor::sequenceLess(lane.finishAt, availableSequence)) {
+			availableSequence = lane.finishAt;
+		}
+
+		for (disruptor::seq_t seq = nextSequence; ; ++seq) {
+			// freed before execute(), which may send to this lane even when it is full
+			MsgPtr msg = std::move(lane.ring.preallocated(seq));
+			lane.gatingSequence->setOrdered(seq);
+			if (msg->execute() || seq == availableSequence) {
+				break;
+			}
+		}
+		lane.ring.signalCapacity();
+	}
+
+	void run() {
+		while (!m_done) {
+			const int lane = nextLane();
+			if (lane >= 0) {
+				drain(m_lanes[lane]);
+			} else if (m_finishing) {
+				m_done = true;
+			} else {
+				m_waitStrategy->waitFor([this]() { return hasMessages(); });
+			}
+		}
+	}
+
+	Lane m_lanes[LANES];
+	const size_t m_starvationLimit;
+	const size_t m_batchLimit;
+	bool m_finishing; // only touched by the active thread
+	std::atomic<bool> m_finishSent;
+	std::atomic<bool> m_done;
+	std::shared_ptr<WaitStrategy> m_waitStrategy;
+	std::thread m_thread;
+};
+
+#endif // PRIORITYACTIVE_H
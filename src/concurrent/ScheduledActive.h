@@ -0,0 +1,251 @@
+#ifndef SCHEDULEDACTIVE_H
+#define SCHEDULEDACTIVE_H
+
+#include "Active.h"
+#include "ThreadPool.h"
+#include "disruptor/RingBuffer.h"
+
+#include <exception/Exception.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+/** Active object without a thread of its own
+ *
+ *  Messages go to a lock free mailbox as with Active, but the actor is
+ *  run by a ThreadPool, so thousands of actors share a few threads:
+ *
+ *      ThreadPool pool(4);
+ *      ScheduledActive<> session(pool);
+ *      session.send(MsgPtr(new LoginMessage(...)));
+ *
+ *  The actor counts its pending messages. The send that finds it idle
+ *  pushes its activation to the pool, later sends only publish. An
+ *  activation runs at most budget messages, then goes behind the other
+ *  actors if more are pending, so one actor never runs on two threads
+ *  at once and a busy one cannot hold a thread. A message whose
+ *  execute() returns true ends its activation early.
+ *
+ *  As with Active, an exception thrown by a message ends the program.
+ *  A full mailbox makes send() wait, except on a pool thread: there the
+ *  waiting thread may be the one that must empty the mailbox, so the
+ *  message goes to an unbounded overflow queue that the activation runs
+ *  once the ring messages sent before it are done. trySend() never waits
+ *  nor overflows, it returns false on a full mailbox so the sender can
+ *  hold the message back itself. The pool must outlive its actors, the
+ *  destructor waits for the messages that were already sent. On a pool
+ *  thread it runs them itself, their activation may be queued behind
+ *  the one that destroys the actor; an actor must not destroy itself.
+ */
+template<class RBWaitStrategy = disruptor::SpinWaitStrategy, int QUEUE_LOG = 10>
+class ScheduledActive: public CacheAligned {
+public:
+
+	typedef typename Active<RBWaitStrategy, QUEUE_LOG>::Message Message;
+
+	typedef std::shared_ptr<Message> MsgPtr;
+
+	typedef disruptor::RingBuffer<MsgPtr, QUEUE_LOG, RBWaitStrategy, disruptor::MultiProducerSequencer, disruptor::MultiProducerPublisher> RingBuffer_t;
+
+	ScheduledActive(ThreadPool& pool, size_t budget = 64)
+		: m_pool(pool)
+		, m_queue()
+		, m_gatingSequence(m_queue.newSequence())
+		, m_budget(budget)
+		, m_pending(0)
+		, m_overflowing(false)
+		, m_activation(new Activation(this))
+	{
+		if (m_budget == 0) {
+			throw ExceptionLib::ProgrammingError("ScheduledActive budget must be greater than 0");
+		}
+		m_queue.addGatingSequence(m_gatingSequence);
+	}
+
+	~ScheduledActive() {
+		const bool poolThread = ThreadPool::onPoolThread();
+		while (m_pending.load() != 0) {
+			if (!poolThread || !m_activation->tryRun()) {
+				std::this_thread::yield();
+			}
+		}
+		// activations still queued find nothing to run
+		m_activation->detach();
+	}
+
+	void send(MsgPtr msg) {
+		msg->weakThis = msg;
+		if (!ThreadPool::onPoolThread()) {
+			m_queue.publishEvent(MoveToSlot(), msg);
+		} else if (!tryPublish(msg)) {
+			overflow(msg);
+		}
+		counted();
+	}
+
+	// false when the mailbox is full, the message is not sent then
+	bool trySend(MsgPtr msg) {
+		msg->weakThis = msg;
+		if (!tryPublish(msg)) {
+			return false;
+		}
+		counted();
+		return true;
+	}
+
+	bool hasAvailableCapacity(int required) {
+		return m_queue.hasAvailableCapacity(required);
+	}
+
+	// no message is pending or running
+	bool idle() const {
+		return m_pending.load() == 0;
+	}
+
+private:
+	ScheduledActive(const ScheduledActive&);
+	ScheduledActive& operator=(const ScheduledActive&);
+
+	struct MoveToSlot {
+		void operator()(MsgPtr& slot, disruptor::seq_t, MsgPtr& m) const {
+			slot = std::move(m);
+		}
+	};
+
+	// the ring sequence claimed when the message overflowed, and the message
+	typedef std::pair<disruptor::seq_t, MsgPtr> Overflowed;
+
+	bool tryPublish(MsgPtr& msg) {
+		// while messages overflow, a later one from the same sender must not overtake them
+		if (m_overflowing.load()) {
+			return false;
+		}
+		return m_queue.tryPublishEvent(MoveToSlot(), msg);
+	}
+
+	void overflow(MsgPtr& msg) {
+		std::lock_guard<std::mutex> lock(m_overflowLock);
+		m_overflow.push_back(Overflowed(m_queue.cursorVal(), std::move(msg)));
+		m_overflowing.store(true);
+	}
+
+	// counted after the publish, so a counted message is always visible to the activation
+	void counted() {
+		if (m_pending.fetch_add(1) == 0) {
+			m_pool.pushWork(m_activation);
+		}
+	}
+
+	// outlives the actor in the pool queue, the lock keeps activate() on one thread
+	class Activation: public Task {
+	public:
+		Activation(ScheduledActive* a) : m_active(a) {}
+
+		void run() {
+			std::lock_guard<std::mutex> lock(m_lock);
+			if (m_active != NULL) {
+				m_active->activate();
+			}
+		}
+
+		// false if another thread is running it
+		bool tryRun() {
+			std::unique_lock<std::mutex> lock(m_lock, std::try_to_lock);
+			if (!lock.owns_lock()) {
+				return false;
+			}
+			if (m_active != NULL) {
+				m_active->activate();
+			}
+			return true;
+		}
+
+		void detach() {
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_active = NULL;
+		}
+
+		// activate() never throws
+		void cancel(ExceptionLib::ExceptionBase*) {}
+
+	private:
+		std::mutex m_lock;
+		ScheduledActive* m_active;
+	};
+
+	void activate() noexcept {
+		const long pending = m_pending.load();
+		if (pending == 0) {
+			// an extra activation left by a destructor that ran the pending ones
+			return;
+		}
+		const long limit = std::min<long>(pending, m_budget);
+		const disruptor::seq_t nextSequence = m_gatingSequence->value() + 1;
+		disruptor::seq_t availableSequence = m_queue.highestPublishedSequence(nextSequence, m_queue.cursorVal());
+
+		long executed = 0;
+		bool yielded = false;
+		if (!disruptor::sequenceLess(availableSequence, nextSequence)) {
+			if (availableSequence - nextSequence >= static_cast<size_t>(limit)) {
+				availableSequence = nextSequence + limit - 1;
+			}
+
+			for (disruptor::seq_t seq = nextSequence; ; ++seq) {
+				// freed before execute(), which may send to this actor even when it is full
+				MsgPtr msg = std::move(m_queue.preallocated(seq));
+				m_gatingSequence->setOrdered(seq);
+				++executed;
+				yielded = msg->execute();
+				if (yielded || seq == availableSequence) {
+					break;
+				}
+			}
+			m_queue.signalCapacity();
+		}
+
+		while (!yielded && executed < limit && m_overflowing.load()) {
+			MsgPtr msg = nextOverflowed();
+			if (!msg) {
+				break;
+			}
+			++executed;
+			yielded = msg->execute();
+		}
+
+		// the actor may be destroyed as soon as the count reaches 0
+		if (m_pending.fetch_sub(executed) != executed) {
+			m_pool.pushWork(m_activation);
+		}
+	}
+
+	// empty once the ring messages claimed before the first overflowed one are still pending
+	MsgPtr nextOverflowed() {
+		MsgPtr msg;
+		std::lock_guard<std::mutex> lock(m_overflowLock);
+		if (!m_overflow.empty() && !disruptor::sequenceLess(m_gatingSequence->value(), m_overflow.front().first)) {
+			msg = std::move(m_overflow.front().second);
+			m_overflow.pop_front();
+		}
+		if (m_overflow.empty()) {
+			m_overflowing.store(false);
+		}
+		return msg;
+	}
+
+	ThreadPool& m_pool;
+	RingBuffer_t m_queue;
+	std::shared_ptr<disruptor::Sequence> m_gatingSequence;
+	const size_t m_budget;
+	std::atomic<long> m_pending;
+	std::atomic<bool> m_overflowing;
+	std::mutex m_overflowLock;
+	std::deque<Overflowed> m_overflow;
+	std::shared_ptr<Activation> m_activation;
+};
+
+#endif // SCHEDULEDACTIVE_H
@@ -61,7 +61,7 @@ inline bool semaphore::try_wait() {
 
 template<class Rep, class Period>
 inline bool semaphore::try_wait_for(const std::chrono::duration<Rep, Period>& d) {
-    std::lock_guard<std::mutex> lock{mutex};
+    std::unique_lock<std::mutex> lock{mutex};
 
     if (count > 0) {
         --count;
@@ -0,0 +1,131 @@
+#include "SharedMemory.h"
+#include "Numa.h"
+
+#include <exception/Exception.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <thread>
+
+using namespace ExceptionLib;
+
+namespace {
+
+	std::string systemError(const char* call, const std::string& name) {
+		return std::string(call) + "(" + name + ") failed: " + strerror(errno);
+	}
+
+	struct FileDescriptor {
+		int fd;
+		FileDescriptor(int f) : fd(f) {}
+		~FileDescriptor() {
+			if (fd >= 0) {
+				close(fd);
+			}
+		}
+	};
+}
+
+SharedMemory::SharedMemory(const std::string& name, size_t size, Mode mode, const MemoryOptions& options,
+		std::chrono::steady_clock::time_point sizedBy)
+	: m_name(name)
+	, m_data(MAP_FAILED)
+	, m_size(size)
+	, m_locked(false)
+{
+	if (options.hugePages != MemoryOptions::NO_HUGE_PAGES) {
+		throw Exception("huge pages are not supported for shared memory objects");
+	}
+
+	const int flags = mode == CREATE ? O_RDWR | O_CREAT | O_EXCL : O_RDWR;
+	FileDescriptor file(shm_open(name.c_str(), flags, 0600));
+	if (file.fd < 0) {
+		throw Exception(systemError("shm_open", name));
+	}
+
+	if (mode == CREATE) {
+		if (ftruncate(file.fd, size) != 0) {
+			const std::string msg = systemError("ftruncate", name);
+			shm_unlink(name.c_str());
+			throw Exception(msg);
+		}
+	} else {
+		struct stat st;
+		while (true) {
+			if (fstat(file.fd, &st) != 0) {
+				throw Exception(systemError("fstat", name));
+			}
+			if (st.st_size != 0) {
+				break;
+			}
+			if (std::chrono::steady_clock::now() > sizedBy) {
+				throw Exception("shared memory object " + name + " is empty, its creator did not size it");
+			}
+			std::this_thread::yield();
+		}
+		m_size = st.st_size;
+	}
+
+	m_data = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+	if (m_data == MAP_FAILED) {
+		const std::string msg = systemError("mmap", name);
+		if (mode == CREATE) {
+			shm_unlink(name.c_str());
+		}
+		throw Exception(msg);
+	}
+
+	// places only pages that are not there yet, an opener comes too late for most
+	if (options.numaNode >= 0) {
+		try {
+			Numa::preferNode(m_data, m_size, options.numaNode);
+		} catch (...) {
+			munmap(m_data, m_size);
+			if (mode == CREATE) {
+				shm_unlink(name.c_str());
+			}
+			throw;
+		}
+	}
+
+	if (options.prefault) {
+		// other processes may be writing already, so an opener only reads
+		const size_t pageSize = sysconf(_SC_PAGESIZE);
+		volatile char* bytes = static_cast<char*>(m_data);
+		for (size_t offset = 0; offset < m_size; offset += pageSize) {
+			if (mode == CREATE) {
+				bytes[offset] = 0;
+			} else {
+				(void)bytes[offset];
+			}
+		}
+	}
+
+	if (options.lock) {
+		if (mlock(m_data, m_size) != 0) {
+			const std::string msg = systemError("mlock", name);
+			munmap(m_data, m_size);
+			if (mode == CREATE) {
+				shm_unlink(name.c_str());
+			}
+			throw Exception(msg);
+		}
+		m_locked = true;
+	}
+}
+
+SharedMemory::~SharedMemory()
+{
+	if (m_locked) {
+		munlock(m_data, m_size);
+	}
+	munmap(m_data, m_size);
+}
+
+void SharedMemory::unlink(const std::string& name)
+{
+	shm_unlink(name.c_str());
+}
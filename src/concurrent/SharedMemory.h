@@ -0,0 +1,58 @@
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include "MappedMemory.h"
+#include <chrono>
+#include <stddef.h>
+#include <string>
+
+/** A named POSIX shared memory object mapped into this process
+ *
+ *  The creator sizes the object, other processes open it by name and
+ *  map whatever size it has. An opener that comes between the creator's
+ *  shm_open and ftruncate sees an empty object, so it polls the size
+ *  until sizedBy. The mapping may land on a different
+ *  address in every process, so the contents must not hold pointers.
+ *  Destroying the object only unmaps it, the name stays valid until
+ *  unlink() is called.
+ */
+class SharedMemory {
+public:
+
+	enum Mode {
+		CREATE, //!< fails if the name already exists
+		OPEN    //!< fails if the name does not exist, the size argument is ignored
+	};
+
+	// MemoryOptions::hugePages is not supported for shared objects
+	SharedMemory(const std::string& name, size_t size, Mode mode, const MemoryOptions& options = MemoryOptions(),
+			std::chrono::steady_clock::time_point sizedBy = std::chrono::steady_clock::time_point());
+
+	~SharedMemory();
+
+	// removes the name, mappings that exist stay valid
+	static void unlink(const std::string& name);
+
+	void* data() const {
+		return m_data;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	const std::string& name() const {
+		return m_name;
+	}
+
+private:
+	SharedMemory(const SharedMemory&);
+	SharedMemory& operator=(const SharedMemory&);
+
+	std::string m_name;
+	void* m_data;
+	size_t m_size;
+	bool m_locked;
+};
+
+#endif // SHAREDMEMORY_H
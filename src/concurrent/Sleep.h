@@ -9,6 +9,16 @@ namespace SleepUtil {
 
 	void usleep (unsigned long usecs);
 
+	// hint for busy wait loops, lets the sibling hyperthread run and saves power
+	inline void cpuRelax()
+	{
+#if defined(__i386__) || defined(__x86_64__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		__asm__ __volatile__("yield");
+#endif
+	}
+
 }
 
 #endif // SLEEP_H
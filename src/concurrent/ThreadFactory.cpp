@@ -0,0 +1,152 @@
+#include "ThreadFactory.h"
+#include "Numa.h"
+
+#include <exception/Exception.h>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string.h>
+#include <string>
+
+#include <pthread.h>
+#include <sched.h>
+
+using namespace ExceptionLib;
+
+namespace {
+
+	std::string threadError(const char* call, int error) {
+		return std::string(call) + " failed: " + strerror(error);
+	}
+
+#ifdef __linux__
+	int nativePolicy(ThreadOptions::SchedulingPolicy policy) {
+		switch (policy) {
+		case ThreadOptions::SCHED_BATCH_POLICY:
+			return SCHED_BATCH;
+		case ThreadOptions::SCHED_IDLE_POLICY:
+			return SCHED_IDLE;
+		case ThreadOptions::SCHED_FIFO_POLICY:
+			return SCHED_FIFO;
+		case ThreadOptions::SCHED_RR_POLICY:
+			return SCHED_RR;
+		default:
+			return SCHED_OTHER;
+		}
+	}
+#endif
+}
+
+ThreadFactory::ThreadFactory()
+	: m_created(0)
+{
+}
+
+ThreadFactory::ThreadFactory(const ThreadOptions& options)
+	: m_options(1, options)
+	, m_created(0)
+{
+}
+
+ThreadFactory::ThreadFactory(const std::vector<ThreadOptions>& options)
+	: m_options(options)
+	, m_created(0)
+{
+}
+
+ThreadFactory::~ThreadFactory()
+{
+}
+
+std::thread ThreadFactory::newThread(std::function<void()> body)
+{
+	const size_t n = m_created++;
+	if (m_options.empty()) {
+		return std::thread(body);
+	}
+
+	ThreadOptions options = m_options[n % m_options.size()];
+	if (!options.name.empty()) {
+		std::ostringstream name;
+		name << options.name << "-" << n;
+		options.name = name.str();
+	}
+
+	std::shared_ptr<std::promise<void> > placed(new std::promise<void>);
+	std::future<void> result = placed->get_future();
+	std::thread thread([options, body, placed](){
+		try {
+			applyToCurrentThread(options);
+		} catch (...) {
+			placed->set_exception(std::current_exception());
+			return;
+		}
+		placed->set_value();
+		body();
+	});
+
+	try {
+		result.get();
+	} catch (...) {
+		thread.join();
+		throw;
+	}
+	return thread;
+}
+
+#ifdef __linux__
+
+void ThreadFactory::applyToCurrentThread(const ThreadOptions& options)
+{
+	const pthread_t self = pthread_self();
+
+	if (!options.name.empty()) {
+		// the kernel keeps 16 bytes including the terminator
+		const int rc = pthread_setname_np(self, options.name.substr(0, 15).c_str());
+		if (rc != 0) {
+			throw Exception(threadError("pthread_setname_np", rc));
+		}
+	}
+
+	if (!options.cpus.empty()) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (size_t i = 0; i < options.cpus.size(); ++i) {
+			if (options.cpus[i] < 0 || options.cpus[i] >= CPU_SETSIZE) {
+				throw Exception("CPU number out of range");
+			}
+			CPU_SET(options.cpus[i], &cpus);
+		}
+		const int rc = pthread_setaffinity_np(self, sizeof(cpus), &cpus);
+		if (rc != 0) {
+			throw Exception(threadError("pthread_setaffinity_np", rc));
+		}
+	}
+
+	if (options.policy != ThreadOptions::INHERIT_SCHEDULING) {
+		sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = options.priority;
+		const int rc = pthread_setschedparam(self, nativePolicy(options.policy), &param);
+		if (rc != 0) {
+			throw Exception(threadError("pthread_setschedparam", rc));
+		}
+	}
+
+	// after the affinity, so the thread already runs on the node it prefers
+	if (options.numaNode >= 0) {
+		Numa::preferNodeForThread(options.numaNode);
+	}
+}
+
+#else
+
+void ThreadFactory::applyToCurrentThread(const ThreadOptions& options)
+{
+	if (!options.name.empty() || !options.cpus.empty()
+			|| options.policy != ThreadOptions::INHERIT_SCHEDULING || options.numaNode >= 0) {
+		throw Exception("thread placement is not supported on this platform");
+	}
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef THREADFACTORY_H
+#define THREADFACTORY_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ThreadOptions {
+
+	enum SchedulingPolicy {
+		INHERIT_SCHEDULING, //!< keep whatever the creating thread has
+		SCHED_NORMAL_POLICY,
+		SCHED_BATCH_POLICY,
+		SCHED_IDLE_POLICY,
+		SCHED_FIFO_POLICY,  //!< real time, needs CAP_SYS_NICE or RLIMIT_RTPRIO
+		SCHED_RR_POLICY     //!< real time, needs CAP_SYS_NICE or RLIMIT_RTPRIO
+	};
+
+	ThreadOptions()
+		: policy(INHERIT_SCHEDULING)
+		, priority(0)
+		, numaNode(-1)
+	{}
+
+	std::string name;      //!< the thread is named "<name>-<n>", cut to 15 characters
+	std::vector<int> cpus; //!< CPUs the thread may run on, empty for all
+	SchedulingPolicy policy;
+	int priority;          //!< 1 to 99 for the real time policies, otherwise 0
+	int numaNode;          //!< preferred node for the thread's allocations, -1 for the default
+};
+
+/** Creates the threads of Active, ThreadPool, Disruptor and WorkerPool
+ *
+ *  The n-th thread gets options[n % options.size()]. It applies them to
+ *  itself before it runs its body and newThread() only returns once that
+ *  worked, otherwise the thread never runs the body and newThread()
+ *  throws. A default constructed factory creates plain threads.
+ *
+ *  A busy spinning consumer usually wants a CPU of its own, away from
+ *  the producer's hyperthread sibling, and a numaNode matching that CPU.
+ *  Memory allocated before the thread exists, like a ring buffer, does
+ *  not follow the thread; place it with MemoryOptions::numaNode.
+ */
+class ThreadFactory {
+public:
+
+	ThreadFactory();
+
+	explicit ThreadFactory(const ThreadOptions& options);
+
+	explicit ThreadFactory(const std::vector<ThreadOptions>& options);
+
+	virtual ~ThreadFactory();
+
+	virtual std::thread newThread(std::function<void()> body);
+
+	// applies options to the calling thread, the name is used as given
+	static void applyToCurrentThread(const ThreadOptions& options);
+
+private:
+	ThreadFactory(const ThreadFactory&);
+	ThreadFactory& operator=(const ThreadFactory&);
+
+	const std::vector<ThreadOptions> m_options;
+	std::atomic<size_t> m_created;
+};
+
+#endif // THREADFACTORY_H
@@ -2,9 +2,31 @@
 
 using namespace ExceptionLib;
 
+namespace {
+	thread_local bool t_poolThread = false;
+}
+
 ThreadPool::ThreadPool(int size) : m_threads(size) {
+	ThreadFactory plain;
 	for (int i = 0; i < size; ++i) {
-		m_threads[i].startUp(this);
+		m_threads[i].startUp(this, plain);
+	}
+}
+
+
+ThreadPool::ThreadPool(int size, ThreadFactory& factory) : m_threads(size) {
+	int started = 0;
+	try {
+		for (; started < size; ++started) {
+			m_threads[started].startUp(this, factory);
+		}
+	} catch (...) {
+		// no destructor runs for a pool that never finished construction
+		m_work.interrupt();
+		for (int i = 0; i < started; ++i) {
+			m_threads[i].finish();
+		}
+		throw;
 	}
 }
 
@@ -19,6 +41,11 @@ void ThreadPool::pushWork(Work w) {
 }
 
 
+bool ThreadPool::onPoolThread() {
+	return t_poolThread;
+}
+
+
 void ThreadPool::finish() {
 	m_work.interrupt();
 	for (size_t i = 0; i < m_threads.size(); ++i) {
@@ -32,6 +59,7 @@ ThreadPool::PoolThread::PoolThread(const PoolThread&) : pool(NULL), done(false)
 
 void ThreadPool::PoolThread::run() {
 
+	t_poolThread = true;
 	while(!done) {
 
 		try {
@@ -53,9 +81,9 @@ void ThreadPool::PoolThread::run() {
 }
 
 
-void ThreadPool::PoolThread::startUp(ThreadPool* p) {
+void ThreadPool::PoolThread::startUp(ThreadPool* p, ThreadFactory& factory) {
 	pool = p;
-	this->start();
+	this->start(factory);
 }
 
 
@@ -64,9 +92,9 @@ void ThreadPool::PoolThread::finish() {
 	wait();
 }
 
-void ThreadPool::PoolThread::start()
+void ThreadPool::PoolThread::start(ThreadFactory& factory)
 {
-    m_thread = std::thread([&](){ run(); });
+    m_thread = factory.newThread([&](){ run(); });
 }
 
 void ThreadPool::PoolThread::wait()
@@ -5,6 +5,7 @@
 #include <vector>
 #include <future>
 #include "MessageQueue.h"
+#include "ThreadFactory.h"
 #include <memory>
 #include <deque>
 #include <exception/Exception.h>
@@ -63,12 +64,17 @@ public:
 
 	ThreadPool(int size);
 
+	ThreadPool(int size, ThreadFactory& factory);
+
 	~ThreadPool();
 
 	void pushWork(Work w);
 
 	void finish();
 
+	// true on the threads of any pool, where waiting on other work may deadlock it
+	static bool onPoolThread();
+
 
 
     template<class R>
@@ -92,11 +98,11 @@ private:
 
 		virtual void run();
 
-		void startUp(ThreadPool* p);
+		void startUp(ThreadPool* p, ThreadFactory& factory);
 
 		void finish();
 
-        void start();
+        void start(ThreadFactory& factory);
 
         void wait();
 
@@ -0,0 +1,129 @@
+#ifndef BATCHEVENTPROCESSOR_H
+#define BATCHEVENTPROCESSOR_H
+
+#include "EventProcessor.h"
+#include "Sequence.h"
+#include "SequenceBarrier.h"
+#include "Instrumentation.h"
+#include <exception/Exception.h>
+#include <atomic>
+#include <memory>
+
+namespace disruptor {
+
+	/** Event loop of a consumer that sees every event of the ring.
+	 *
+	 *  The handler must provide
+	 *
+	 *      void onEvent(T& event, seq_t sequence, bool endOfBatch);
+	 *
+	 *  and may provide onTimeout(seq_t), see TimeoutBlockingWaitStrategy.
+	 *
+	 *  Each iteration waits on the barrier once, hands every event up to
+	 *  the highest available sequence to the handler and only then
+	 *  publishes the processor's own sequence. Producers and downstream
+	 *  consumers therefore see one store per batch instead of one per event.
+	 *
+	 *  Barrier_t may name a final barrier type such as
+	 *  RingBuffer::SingleBarrier to call waitFor without virtual dispatch.
+	 */
+	template<class RingBuffer_t, class Handler, class Barrier_t = SequenceBarrier>
+	class BatchEventProcessor: public EventProcessor {
+	public:
+
+		BatchEventProcessor(RingBuffer_t& ring, std::shared_ptr<Barrier_t> barrier, Handler& handler)
+			: m_ring(ring)
+			, m_barrier(barrier)
+			, m_handler(handler)
+			, m_sequence(ring.newSequence())
+			, m_state(IDLE)
+		{}
+
+		std::shared_ptr<Sequence> sequence() const {
+			return m_sequence;
+		}
+
+#ifdef CONCURRENT_INSTRUMENTATION
+		// may be read while the processor runs
+		const ConsumerStats& stats() const {
+			return m_stats;
+		}
+#endif
+
+		void halt() {
+			m_state = HALTED;
+			m_barrier->alert();
+		}
+
+		bool isRunning() const {
+			return m_state != IDLE;
+		}
+
+		void run() {
+			int expected = IDLE;
+			if (!m_state.compare_exchange_strong(expected, RUNNING)) {
+				if (expected == RUNNING) {
+					throw ExceptionLib::InvalidStateException("BatchEventProcessor is already running");
+				}
+				// halted before it even started
+				m_state = IDLE;
+				return;
+			}
+			m_barrier->clearAlert();
+
+			seq_t nextSequence = m_sequence->value() + 1;
+
+			try {
+				while (true) {
+					try {
+						const seq_t availableSequence = m_barrier->waitFor(nextSequence);
+#ifdef CONCURRENT_INSTRUMENTATION
+						if (!sequenceLess(availableSequence, nextSequence)) {
+							m_stats.batchSize.record(availableSequence - nextSequence + 1);
+							m_stats.queueDepth.record(m_ring.cursorVal() - (nextSequence - 1));
+						}
+#endif
+
+						while (!sequenceLess(availableSequence, nextSequence)) {
+							typename RingBuffer_t::value_type& event = m_ring.get(nextSequence);
+#ifdef CONCURRENT_INSTRUMENTATION
+							m_stats.latencyNS.record(Instrumentation::now() - m_ring.publishTime(nextSequence));
+#endif
+							m_handler.onEvent(event, nextSequence, nextSequence == availableSequence);
+							++nextSequence;
+						}
+						m_sequence->changeValue(availableSequence);
+						m_ring.signalCapacity();
+
+					} catch (const TimeoutException&) {
+						notifyTimeout(m_handler, m_sequence->value(), 0);
+					} catch (const AlertException&) {
+						if (m_state == HALTED) {
+							break;
+						}
+					}
+				}
+			} catch (...) {
+				m_state = IDLE;
+				throw;
+			}
+			m_state = IDLE;
+		}
+
+	private:
+
+		enum State { IDLE, HALTED, RUNNING };
+
+		RingBuffer_t& m_ring;
+		std::shared_ptr<Barrier_t> m_barrier;
+		Handler& m_handler;
+		std::shared_ptr<Sequence> m_sequence;
+		std::atomic<int> m_state;
+#ifdef CONCURRENT_INSTRUMENTATION
+		ConsumerStats m_stats;
+#endif
+	};
+
+}
+
+#endif // BATCHEVENTPROCESSOR_H
@@ -0,0 +1,234 @@
+#ifndef DISRUPTOR_H
+#define DISRUPTOR_H
+
+#include "BatchEventProcessor.h"
+#include "EventProcessor.h"
+#include "MappedMemory.h"
+#include "Sequence.h"
+#include "SequenceBarrier.h"
+#include "ThreadFactory.h"
+#include <exception/Exception.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace disruptor {
+
+	template<class RingBuffer_t>
+	class Disruptor;
+
+	/** The processors created by one step of the DSL
+	 *
+	 *  then() makes the next handlers wait for every processor of the group.
+	 */
+	template<class RingBuffer_t>
+	class EventHandlerGroup {
+	public:
+
+		EventHandlerGroup(Disruptor<RingBuffer_t>& disruptor, const std::vector<std::shared_ptr<Sequence> >& sequences)
+			: m_disruptor(&disruptor)
+			, m_sequences(sequences)
+		{}
+
+		template<class... Handlers>
+		EventHandlerGroup then(Handlers&... handlers) {
+			return m_disruptor->createEventProcessors(m_sequences, handlers...);
+		}
+
+		template<class... Handlers>
+		EventHandlerGroup handleEventsWith(Handlers&... handlers) {
+			return then(handlers...);
+		}
+
+		const std::vector<std::shared_ptr<Sequence> >& sequences() const {
+			return m_sequences;
+		}
+
+		std::shared_ptr<SequenceBarrier> asSequenceBarrier() {
+			return m_disruptor->ringBuffer().newBarrier(m_sequences.begin(), m_sequences.end());
+		}
+
+	private:
+		Disruptor<RingBuffer_t>* m_disruptor;
+		std::vector<std::shared_ptr<Sequence> > m_sequences;
+	};
+
+
+	/** Builds and runs a graph of BatchEventProcessors on one ring
+	 *
+	 *      Disruptor<RingBuffer_t> disruptor;
+	 *      disruptor.handleEventsWith(journaler, replicator).then(business);
+	 *      disruptor.start();
+	 *
+	 *  Only the sequences at the end of each chain gate the producers,
+	 *  the others are already covered by the barriers downstream.
+	 *  The handlers are referenced, not copied, and must outlive the Disruptor.
+	 */
+	template<class RingBuffer_t>
+	class Disruptor {
+	public:
+
+		typedef EventHandlerGroup<RingBuffer_t> Group_t;
+
+		Disruptor()
+			: m_ring(new RingBuffer_t)
+			, m_started(false)
+		{}
+
+		Disruptor(size_t bufferSizeLog2, const MemoryOptions& options = MemoryOptions())
+			: m_ring(new RingBuffer_t(bufferSizeLog2, options))
+			, m_started(false)
+		{}
+
+		~Disruptor() {
+			if (m_started) {
+				halt();
+			}
+		}
+
+		RingBuffer_t& ringBuffer() {
+			return *m_ring;
+		}
+
+		// handlers that only depend on the producers
+		template<class... Handlers>
+		Group_t handleEventsWith(Handlers&... handlers) {
+			return createEventProcessors(std::vector<std::shared_ptr<Sequence> >(), handlers...);
+		}
+
+		// group of the processors already created for the given handlers
+		template<class... Handlers>
+		Group_t after(Handlers&... handlers) {
+			std::vector<std::shared_ptr<Sequence> > sequences;
+			collectSequences(sequences, handlers...);
+			return Group_t(*this, sequences);
+		}
+
+		void start() {
+			ThreadFactory plain;
+			start(plain);
+		}
+
+		// one thread per processor, in the order the handlers were added
+		void start(ThreadFactory& factory) {
+			if (m_started) {
+				throw ExceptionLib::InvalidStateException("Disruptor has already been started");
+			}
+			m_started = true;
+			for (size_t i = 0; i < m_consumers.size(); ++i) {
+				std::shared_ptr<EventProcessor> processor = m_consumers[i].processor;
+				m_threads.push_back(factory.newThread([processor](){ processor->run(); }));
+			}
+		}
+
+		void halt() {
+			for (size_t i = 0; i < m_consumers.size(); ++i) {
+				m_consumers[i].processor->halt();
+			}
+			for (size_t i = 0; i < m_threads.size(); ++i) {
+				m_threads[i].join();
+			}
+			m_threads.clear();
+			m_started = false;
+		}
+
+		// waits until every published event went through the whole graph, then halts
+		void shutdown() {
+			while (hasBacklog()) {
+				std::this_thread::yield();
+			}
+			halt();
+		}
+
+	private:
+		Disruptor(const Disruptor&);
+		Disruptor& operator=(const Disruptor&);
+
+		friend class EventHandlerGroup<RingBuffer_t>;
+
+		struct ConsumerInfo {
+			std::shared_ptr<EventProcessor> processor;
+			const void* handler;
+			bool endOfChain;
+		};
+
+		template<class... Handlers>
+		Group_t createEventProcessors(const std::vector<std::shared_ptr<Sequence> >& barrierSequences, Handlers&... handlers) {
+			if (m_started) {
+				throw ExceptionLib::InvalidStateException("All event handlers must be added before calling start");
+			}
+			// most stages wait on the producers or on a single upstream stage,
+			// give those the statically dispatched single sequence barrier
+			std::vector<std::shared_ptr<Sequence> > sequences;
+			if (barrierSequences.empty()) {
+				addProcessors(m_ring->newSingleBarrier(), sequences, handlers...);
+			} else if (barrierSequences.size() == 1) {
+				addProcessors(m_ring->newSingleBarrier(barrierSequences[0]), sequences, handlers...);
+			} else {
+				addProcessors(m_ring->newMultipleBarrier(barrierSequences.begin(), barrierSequences.end()), sequences, handlers...);
+			}
+
+			m_ring->addGatingSequences(sequences.begin(), sequences.end());
+			for (size_t i = 0; i < barrierSequences.size(); ++i) {
+				m_ring->removeGatingSequence(barrierSequences[i]);
+				markNotEndOfChain(barrierSequences[i]);
+			}
+			return Group_t(*this, sequences);
+		}
+
+		template<class Barrier_t>
+		void addProcessors(std::shared_ptr<Barrier_t>, std::vector<std::shared_ptr<Sequence> >&) {}
+
+		template<class Barrier_t, class Handler, class... Handlers>
+		void addProcessors(std::shared_ptr<Barrier_t> barrier, std::vector<std::shared_ptr<Sequence> >& sequences, Handler& handler, Handlers&... rest) {
+			ConsumerInfo info;
+			info.processor.reset(new BatchEventProcessor<RingBuffer_t, Handler, Barrier_t>(*m_ring, barrier, handler));
+			info.handler = &handler;
+			info.endOfChain = true;
+			m_consumers.push_back(info);
+			sequences.push_back(info.processor->sequence());
+			addProcessors(barrier, sequences, rest...);
+		}
+
+		void collectSequences(std::vector<std::shared_ptr<Sequence> >&) {}
+
+		template<class Handler, class... Handlers>
+		void collectSequences(std::vector<std::shared_ptr<Sequence> >& sequences, Handler& handler, Handlers&... rest) {
+			size_t i = 0;
+			while (i < m_consumers.size() && m_consumers[i].handler != &handler) {
+				++i;
+			}
+			if (i == m_consumers.size()) {
+				throw ExceptionLib::InvalidStateException("Handler was not registered with this Disruptor");
+			}
+			sequences.push_back(m_consumers[i].processor->sequence());
+			collectSequences(sequences, rest...);
+		}
+
+		void markNotEndOfChain(const std::shared_ptr<Sequence>& sequence) {
+			for (size_t i = 0; i < m_consumers.size(); ++i) {
+				if (m_consumers[i].processor->sequence() == sequence) {
+					m_consumers[i].endOfChain = false;
+				}
+			}
+		}
+
+		bool hasBacklog() {
+			const seq_t cursor = m_ring->cursorVal();
+			for (size_t i = 0; i < m_consumers.size(); ++i) {
+				if (m_consumers[i].endOfChain && sequenceLess(m_consumers[i].processor->sequence()->value(), cursor)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		std::unique_ptr<RingBuffer_t> m_ring;
+		std::vector<ConsumerInfo> m_consumers;
+		std::vector<std::thread> m_threads;
+		bool m_started;
+	};
+
+}
+
+#endif // DISRUPTOR_H
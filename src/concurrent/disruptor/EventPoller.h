@@ -0,0 +1,116 @@
+#ifndef EVENTPOLLER_H
+#define EVENTPOLLER_H
+
+#include "Sequence.h"
+#include "SequenceBarrier.h"
+#include "Instrumentation.h"
+#include <memory>
+
+namespace disruptor {
+
+	// shared by all pollers, so results of different rings compare
+	struct EventPollerBase {
+		enum PollState {
+			PROCESSING,	// at least one event was handled
+			GATING,		// claimed by a producer or an upstream consumer but not yet available
+			IDLE		// nothing was published after the poller's sequence
+		};
+	};
+
+	/** Consumer driven by the caller's own loop instead of a thread
+	 *
+	 *  poll() never waits. It hands every event available right now to
+	 *  the handler, which must provide
+	 *
+	 *      bool onEvent(T& event, seq_t sequence, bool endOfBatch);
+	 *
+	 *  and return false to end the poll early. The poller's sequence is
+	 *  stored once per poll, producers must gate on it:
+	 *
+	 *      auto poller = ring.newPoller();
+	 *      ring.addGatingSequence(poller->sequence());
+	 *      while (running) {
+	 *          poller->poll(handler);
+	 *          ... other work of the event loop
+	 *      }
+	 */
+	template<class RingBuffer_t, class Barrier_t = SequenceBarrier>
+	class EventPoller: public EventPollerBase {
+	public:
+
+		EventPoller(RingBuffer_t& ring, std::shared_ptr<Barrier_t> barrier)
+			: m_ring(ring)
+			, m_barrier(barrier)
+			, m_sequence(ring.newSequence())
+		{}
+
+		std::shared_ptr<Sequence> sequence() const {
+			return m_sequence;
+		}
+
+#ifdef CONCURRENT_INSTRUMENTATION
+		const ConsumerStats& stats() const {
+			return m_stats;
+		}
+#endif
+
+		template<class Handler>
+		PollState poll(Handler& handler) {
+			const seq_t currentSequence = m_sequence->value();
+			seq_t nextSequence = currentSequence + 1;
+			const seq_t availableSequence = m_ring.highestPublishedSequence(nextSequence, m_barrier->cursor());
+
+			if (!sequenceLess(availableSequence, nextSequence)) {
+#ifdef CONCURRENT_INSTRUMENTATION
+				m_stats.queueDepth.record(m_ring.cursorVal() - currentSequence);
+#endif
+				seq_t processedSequence = currentSequence;
+				try {
+					bool processNextEvent = true;
+					while (processNextEvent && !sequenceLess(availableSequence, nextSequence)) {
+#ifdef CONCURRENT_INSTRUMENTATION
+						m_stats.latencyNS.record(Instrumentation::now() - m_ring.publishTime(nextSequence));
+#endif
+						processNextEvent = handler.onEvent(m_ring.preallocated(nextSequence), nextSequence, nextSequence == availableSequence);
+						processedSequence = nextSequence++;
+					}
+				} catch (...) {
+					release(currentSequence, processedSequence);
+					throw;
+				}
+				release(currentSequence, processedSequence);
+				return PROCESSING;
+			}
+
+			if (!sequenceLess(m_ring.cursorVal(), nextSequence)) {
+				return GATING;
+			}
+			return IDLE;
+		}
+
+	private:
+
+		void release(seq_t currentSequence, seq_t processedSequence) {
+#ifdef CONCURRENT_INSTRUMENTATION
+			// the handler may stop before the end of what was available
+			if (processedSequence != currentSequence) {
+				m_stats.batchSize.record(processedSequence - currentSequence);
+			}
+#else
+			(void)currentSequence;
+#endif
+			m_sequence->changeValue(processedSequence);
+			m_ring.signalCapacity();
+		}
+
+		RingBuffer_t& m_ring;
+		std::shared_ptr<Barrier_t> m_barrier;
+		std::shared_ptr<Sequence> m_sequence;
+#ifdef CONCURRENT_INSTRUMENTATION
+		ConsumerStats m_stats;
+#endif
+	};
+
+}
+
+#endif // EVENTPOLLER_H
@@ -0,0 +1,43 @@
+#ifndef EVENTPROCESSOR_H
+#define EVENTPROCESSOR_H
+
+#include "Sequence.h"
+#include <memory>
+
+namespace disruptor {
+
+	/** A consumer loop that runs on its own thread.
+	 *
+	 *  run() only returns after halt() is called. The sequence
+	 *  is the one producers and downstream consumers gate on.
+	 */
+	class EventProcessor {
+	public:
+		virtual ~EventProcessor() {}
+
+		virtual void run() = 0;
+
+		virtual void halt() = 0;
+
+		virtual bool isRunning() const = 0;
+
+		virtual std::shared_ptr<Sequence> sequence() const = 0;
+	};
+
+	/* Forwards a wait strategy timeout to handlers that declare
+	 *
+	 *     void onTimeout(seq_t sequence);
+	 *
+	 * and ignores it for the others.
+	 */
+	template<class Handler>
+	auto notifyTimeout(Handler& handler, seq_t sequence, int) -> decltype(handler.onTimeout(sequence), void()) {
+		handler.onTimeout(sequence);
+	}
+
+	template<class Handler>
+	void notifyTimeout(Handler&, seq_t, long) {}
+
+}
+
+#endif // EVENTPROCESSOR_H
@@ -0,0 +1,83 @@
+#ifndef JOURNALHANDLER_H
+#define JOURNALHANDLER_H
+
+#include "Journal.h"
+#include "Sequence.h"
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace disruptor {
+
+	/** Event handler that persists every event before it moves on
+	 *
+	 *  Run it in a BatchEventProcessor and let the business logic gate
+	 *  on it. Each batch is appended to the journal and synced at its
+	 *  last event, and the processor only advances its sequence after
+	 *  the handler returned, so downstream consumers never see an event
+	 *  that is not durable yet. The producers are not slowed down as
+	 *  long as the journal keeps up with the ring.
+	 *
+	 *  Events below the journal's nextSequence() are already in the
+	 *  journal, they come from replayJournal() and are skipped.
+	 */
+	template<class T>
+	class JournalHandler {
+		static_assert(std::is_trivially_copyable<T>::value, "journaled events must be trivially copyable");
+	public:
+
+		JournalHandler(const std::string& directory, const JournalOptions& options = JournalOptions())
+			: m_writer(directory, sizeof(T), options)
+		{}
+
+		void onEvent(T& event, seq_t sequence, bool endOfBatch) {
+			if (sequence >= m_writer.nextSequence()) {
+				m_writer.append(sequence, &event);
+			}
+			if (endOfBatch) {
+				m_writer.sync();
+			}
+		}
+
+		uint64_t nextSequence() const {
+			return m_writer.nextSequence();
+		}
+
+	private:
+		JournalWriter m_writer;
+	};
+
+	/* Publishes the intact records of a journal into a fresh ring,
+	 * a ring's capacity at a time, and returns how many there were.
+	 * Sequences of the ring and of the journal match afterwards, so
+	 * a JournalHandler on the same directory skips the replayed events.
+	 */
+	template<class RingBuffer_t>
+	size_t replayJournal(const std::string& directory, RingBuffer_t& ring) {
+		typedef typename RingBuffer_t::value_type T;
+		static_assert(std::is_trivially_copyable<T>::value, "journaled events must be trivially copyable");
+
+		JournalReader reader(directory, sizeof(T));
+		std::vector<const void*> batch;
+		batch.reserve(ring.capacity());
+
+		size_t replayed = 0;
+		const void* record = reader.next();
+		while (record != NULL) {
+			batch.clear();
+			while (record != NULL && batch.size() < ring.capacity()) {
+				batch.push_back(record);
+				record = reader.next();
+			}
+			ring.publishEvents([](T& event, seq_t, const void* source) {
+				memcpy(&event, source, sizeof(T));
+			}, batch.begin(), batch.end());
+			replayed += batch.size();
+		}
+		return replayed;
+	}
+
+}
+
+#endif // JOURNALHANDLER_H
@@ -0,0 +1,123 @@
+#ifndef PRODUCERWAITSTRATEGY_H
+#define PRODUCERWAITSTRATEGY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Sleep.h"
+
+namespace disruptor {
+
+	/* What a producer does while the ring is full
+	 *
+	 * The sequencers inherit from one of these policies and call
+	 * waitForCapacity(hasCapacity) when they would wrap over the slowest
+	 * consumer. Consumers call signalCapacity() on the ring whenever they
+	 * advance their sequence; that is free unless a producer is parked.
+	 */
+
+	// Busy spins, lowest latency, burns a core while the ring is full
+	class SpinProducerWait {
+	public:
+		template<class Condition>
+		void waitForCapacity(Condition hasCapacity) {
+			while (!hasCapacity()) {}
+		}
+
+		void signalCapacity() {}
+	};
+
+	// Busy spins with the CPU pause hint
+	class PauseProducerWait {
+	public:
+		template<class Condition>
+		void waitForCapacity(Condition hasCapacity) {
+			while (!hasCapacity()) {
+				SleepUtil::cpuRelax();
+			}
+		}
+
+		void signalCapacity() {}
+	};
+
+	// Yields the CPU between checks
+	class YieldProducerWait {
+	public:
+		template<class Condition>
+		void waitForCapacity(Condition hasCapacity) {
+			while (!hasCapacity()) {
+				std::this_thread::yield();
+			}
+		}
+
+		void signalCapacity() {}
+	};
+
+	// Sleeps between checks. The OS rounds short sleeps up to tens of microseconds
+	class SleepProducerWait {
+	public:
+		template<class Condition>
+		void waitForCapacity(Condition hasCapacity) {
+			while (!hasCapacity()) {
+				SleepUtil::usleep(1);
+			}
+		}
+
+		void signalCapacity() {}
+	};
+
+	/** Spins briefly, then parks until a consumer advances
+	 *
+	 *  The producer raises m_parked under the lock before re-checking,
+	 *  so consumers only pay for the lock and notify while someone is
+	 *  parked. Consumers that advance their sequence without calling
+	 *  signalCapacity() are still noticed after the timeout.
+	 */
+	class ParkingProducerWait {
+	public:
+
+		ParkingProducerWait(size_t spinTries = 100, size_t timeoutUS = 1000)
+			: m_spinTries(spinTries)
+			, m_timeout(timeoutUS)
+			, m_parked(false)
+		{}
+
+		template<class Condition>
+		void waitForCapacity(Condition hasCapacity) {
+			for (size_t i = 0; i < m_spinTries; ++i) {
+				if (hasCapacity()) {
+					return;
+				}
+				SleepUtil::cpuRelax();
+			}
+
+			std::unique_lock<std::mutex> lock(m_lock);
+			while (true) {
+				m_parked.store(true);
+				if (hasCapacity()) {
+					return;
+				}
+				m_capacityCondition.wait_for(lock, m_timeout);
+			}
+		}
+
+		void signalCapacity() {
+			if (m_parked.load() && m_parked.exchange(false)) {
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_capacityCondition.notify_all();
+			}
+		}
+
+	private:
+		const size_t m_spinTries;
+		const std::chrono::microseconds m_timeout;
+		std::atomic<bool> m_parked;
+		std::mutex m_lock;
+		std::condition_variable m_capacityCondition;
+	};
+
+}
+
+#endif // PRODUCERWAITSTRATEGY_H
@@ -22,6 +22,12 @@ namespace disruptor {
 
 		void publish(seq_t sequence) {
 			m_cursor.changeValue(sequence);
+			static_cast<SubClass*>(this)->signalAllWhenBlocking();
+		}
+
+		void publish(seq_t /*lo*/, seq_t hi) {
+			m_cursor.changeValue(hi);
+			static_cast<SubClass*>(this)->signalAllWhenBlocking();
 		}
 
 		bool available(seq_t sequence) const {
@@ -29,6 +35,11 @@ namespace disruptor {
 			return (cursor != Sequence::INITIAL_CURSOR_VALUE) && (sequence <= cursor);
 		}
 
+		// everything up to the cursor is published
+		seq_t highestPublishedSequence(seq_t /*lowerBound*/, seq_t availableSequence) const {
+			return availableSequence;
+		}
+
 		void ensureAvailable(seq_t sequence) const {
 
 			while (!available(sequence)) {
@@ -41,7 +52,7 @@ namespace disruptor {
 		}
 
 	private:
-		Sequence m_cursor;
+		PaddedSequence m_cursor;
 	};
 
 	template<class SubClass>
@@ -62,6 +73,15 @@ namespace disruptor {
 			static_cast<SubClass*>(this)->signalAllWhenBlocking();
 		}
 
+		// Marks the whole range [lo, hi] and wakes the consumers only once
+		void publish(seq_t lo, seq_t hi)
+		{
+			for (seq_t sequence = lo; sequence <= hi; ++sequence) {
+				m_availabilityFlags[calculateIndex(sequence)] = calculateAvailabilityFlag(sequence);
+			}
+			static_cast<SubClass*>(this)->signalAllWhenBlocking();
+		}
+
 		bool available(seq_t sequence) const
 		{
 			const seq_t index = calculateIndex(sequence);
@@ -69,6 +89,17 @@ namespace disruptor {
 			return m_availabilityFlags[index] == flag;
 		}
 
+		// the claim cursor runs ahead of slower producers, stop at the first gap
+		seq_t highestPublishedSequence(seq_t lowerBound, seq_t availableSequence) const
+		{
+			for (seq_t sequence = lowerBound; !sequenceLess(availableSequence, sequence); ++sequence) {
+				if (!available(sequence)) {
+					return sequence - 1;
+				}
+			}
+			return availableSequence;
+		}
+
 		void ensureAvailable(seq_t sequence) const
 		{
 			const seq_t index = calculateIndex(sequence);
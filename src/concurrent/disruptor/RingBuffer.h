@@ -1,6 +1,7 @@
 #ifndef RINGBUFFER_H
 #define RINGBUFFER_H
 
+#include "EventPoller.h"
 #include "Publisher.h"
 #include "Sequence.h"
 #include "SequenceBarrier.h"
@@ -8,39 +9,129 @@
 #include "WaitStrategy.h"
 #include <exception/Exception.h>
 #include "HazardPointers.h"
+#include "MappedMemory.h"
+#include "Instrumentation.h"
 
 #include <memory>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
 
 namespace disruptor {
 
-	template<class T, size_t POW, class WaitStrategy_t, class Sequencer_t, template<class> class Publisher_Templ>
-	class RingBuffer: public WaitStrategy_t, public Sequencer_t, public Publisher_Templ<RingBuffer<T, POW, WaitStrategy_t, Sequencer_t, Publisher_Templ> > {
+	template<class T, bool PADDED>
+	struct RingEntry {
+		T value;
+	};
+
+	// One entry per cache line, producers filling neighbouring slots no longer collide
+	template<class T>
+	struct alignas(CONCURRENT_CACHE_LINE_SIZE) RingEntry<T, true> {
+		T value;
+	};
+
+	// POW of a RingBuffer whose size is chosen at construction
+	static const size_t RUNTIME_SIZE = ~size_t(0);
+
+	template<class Entry, size_t POW>
+	class RingEntries {
+	public:
+		static const size_t staticSize = size_t(1) << POW;
+
+		RingEntries(size_t, const MemoryOptions&) {}
+
+		Entry& operator[](seq_t sequence) {
+			return m_entries[sequence & (staticSize-1)];
+		}
+
+	private:
+		Entry m_entries[staticSize];
+	};
+
+	// Entries of a runtime sized ring, placed in a single mapping
+	template<class Entry>
+	class RingEntries<Entry, RUNTIME_SIZE> {
+	public:
+		static const size_t staticSize = 0;
+
+		RingEntries(size_t bufferSizeLog2, const MemoryOptions& options)
+			: m_indexMask((size_t(1) << bufferSizeLog2)-1)
+			, m_memory(sizeof(Entry) << bufferSizeLog2, options)
+			, m_entries(static_cast<Entry*>(m_memory.data()))
+		{
+			for (size_t i = 0; i <= m_indexMask; ++i) {
+				new(&m_entries[i]) Entry();
+			}
+		}
+
+		~RingEntries() {
+			for (size_t i = 0; i <= m_indexMask; ++i) {
+				m_entries[i].~Entry();
+			}
+		}
+
+		Entry& operator[](seq_t sequence) {
+			return m_entries[sequence & m_indexMask];
+		}
 
-		typedef RingBuffer<T, POW, WaitStrategy_t, Sequencer_t, Publisher_Templ> MyType;
-		typedef Publisher_Templ<RingBuffer<T, POW, WaitStrategy_t, Sequencer_t, Publisher_Templ> > Publisher_t;
+	private:
+		const size_t m_indexMask;
+		MappedMemory m_memory;
+		Entry* m_entries;
+	};
+
+	template<class T, size_t POW, class WaitStrategy_t, class Sequencer_t, template<class> class Publisher_Templ, bool PADDED_ENTRIES = false>
+	class RingBuffer: public WaitStrategy_t, public Sequencer_t, public Publisher_Templ<RingBuffer<T, POW, WaitStrategy_t, Sequencer_t, Publisher_Templ, PADDED_ENTRIES> >, public CacheAligned {
+
+		typedef RingBuffer<T, POW, WaitStrategy_t, Sequencer_t, Publisher_Templ, PADDED_ENTRIES> MyType;
+		typedef Publisher_Templ<RingBuffer<T, POW, WaitStrategy_t, Sequencer_t, Publisher_Templ, PADDED_ENTRIES> > Publisher_t;
 
 	public:
 
+		typedef T value_type;
+
 		// consumer
 		T& get(seq_t sequence) {
 			Publisher_t::ensureAvailable(sequence);
-			return m_entries[sequence & indexMask];
+			return m_entries[sequence].value;
 		}
 
-		// producer
-		seq_t next() {
-			HPRecord* rec = Sequencer_t::getHazardPointer();
-			seq_t retVal =  Sequencer_t::next(rec->securePtr(m_gatingSequences));
-			Sequencer_t::releaseHazardPointer(rec);
-			return retVal;
+		// producer, claims n contiguous slots and returns the highest of them
+		seq_t next(size_t n = 1) {
+			return withGatingSequences([this, n](const GatingSequences& gating) {
+				return Sequencer_t::next(gating, n);
+			});
+		}
+
+		seq_t tryNext(size_t n = 1) {
+			return withGatingSequences([this, n](const GatingSequences& gating) {
+				return Sequencer_t::tryNext(gating, n);
+			});
+		}
+
+		/* Sequence for a consumer of this ring
+		 *
+		 * It lives in the ring's GatingSlots while there are free ones, so
+		 * gating on it costs the producers one adjacent cache line in their
+		 * scan. The processors, WorkerPool and Active take their sequences
+		 * from here. Any other sequence can gate as well, it is just
+		 * checked through the slower SequenceArray path.
+		 */
+		std::shared_ptr<Sequence> newSequence() {
+			std::shared_ptr<Sequence> sequence = GatingSlots::acquire(m_slots);
+			if (!sequence) {
+				sequence.reset(new PaddedSequence);
+			}
+			return sequence;
 		}
 
 		void initaliseTo(seq_t sequence) {
-			if (m_gatingSequences != NULL) {
+			if (m_gatingSequences != NULL || m_slots->gating()) {
 				throw ExceptionLib::InvalidStateException("Can only initialise the cursor if not gating sequences have been added");
 			}
 			Sequencer_t::claim(sequence);
-			Publisher_t::publish(sequence);
+			publish(sequence);
 		}
 
         void addGatingSequence(std::shared_ptr<Sequence> s) {
@@ -48,14 +139,28 @@ namespace disruptor {
 		}
 
 		seq_t minimumGatingSequence() const {
-			if (m_gatingSequences == NULL) {
+			if (m_gatingSequences == NULL && !m_slots->gating()) {
 				return Sequence::INITIAL_CURSOR_VALUE;
 			}
-			return minimumSequence(m_gatingSequences);
+			return minimumSequence(GatingSequences(m_slots.get(), m_gatingSequences), ~0-1);
 		}
 
 		template<class SequenceIterator>
 		void addGatingSequences(SequenceIterator begin, SequenceIterator end) {
+			// the ring keeps its own reference while a slot gates
+			std::vector<std::shared_ptr<Sequence> > others;
+			for (SequenceIterator it = begin; it != end; ++it) {
+				const size_t index = m_slots->indexOf(it->get());
+				if (index == GatingSlots::CAPACITY) {
+					others.push_back(*it);
+				} else {
+					m_slotOwners[index] = *it;
+					m_slots->setGating(index, true);
+				}
+			}
+			if (others.empty()) {
+				return;
+			}
 
 			SequenceArray* origArray = NULL;
 			SequenceArray* newArray = NULL;
@@ -72,7 +177,7 @@ namespace disruptor {
 				if (newArray != NULL) {
 					SequenceArray::destroy(newArray);
 				}
-				newArray = SequenceArray::addSequence(origArray, begin, end);
+				newArray = SequenceArray::addSequence(origArray, others.begin(), others.end());
 
             } while (!m_gatingSequences.compare_exchange_weak(origArray, newArray, std::memory_order_release, std::memory_order_relaxed));
 
@@ -81,6 +186,12 @@ namespace disruptor {
 		}
 
         void removeGatingSequence(std::shared_ptr<Sequence> toRemove) {
+			const size_t index = m_slots->indexOf(toRemove.get());
+			if (index != GatingSlots::CAPACITY) {
+				m_slots->setGating(index, false);
+				m_slotOwners[index].reset();
+				return;
+			}
 
 			SequenceArray* origArray = NULL;
 			SequenceArray* newArray = NULL;
@@ -107,35 +218,177 @@ namespace disruptor {
 
 		template<class SequenceIterator>
         std::shared_ptr<SequenceBarrier> newBarrier(SequenceIterator begin, SequenceIterator end) {
-            return std::shared_ptr<SequenceBarrier>(new ProcessingSequenceBarrier<MyType>(this/*m_waitStrategy*/, Sequencer_t::cursor(), SequenceArray::build(begin, end)));
+            return std::shared_ptr<SequenceBarrier>(new ProcessingSequenceBarrier<MyType>(this/*m_waitStrategy*/, this->cursor(), SequenceArray::build(begin, end)));
+		}
+
+		// barrier for a consumer that depends only on the producers
+		std::shared_ptr<SequenceBarrier> newBarrier() {
+			std::shared_ptr<Sequence>* none = NULL;
+			return newBarrier(none, none);
+		}
+
+		typedef StaticSequenceBarrier<MyType, OneSequenceReader> SingleBarrier;
+		typedef StaticSequenceBarrier<MyType, MultipleSequenceReader> MultipleBarrier;
+
+		// statically dispatched barrier on the producers only
+		std::shared_ptr<SingleBarrier> newSingleBarrier() {
+			return std::shared_ptr<SingleBarrier>(new SingleBarrier(this, this->cursor(), NULL, OneSequenceReader(this->cursor())));
+		}
+
+		// statically dispatched barrier on one upstream consumer
+		std::shared_ptr<SingleBarrier> newSingleBarrier(std::shared_ptr<Sequence> dependency) {
+			SequenceArray* dependents = SequenceArray::build(&dependency, &dependency + 1);
+			return std::shared_ptr<SingleBarrier>(new SingleBarrier(this, this->cursor(), dependents, OneSequenceReader(dependency.get())));
+		}
+
+		template<class SequenceIterator>
+		std::shared_ptr<MultipleBarrier> newMultipleBarrier(SequenceIterator begin, SequenceIterator end) {
+			SequenceArray* dependents = SequenceArray::build(begin, end);
+			return std::shared_ptr<MultipleBarrier>(new MultipleBarrier(this, this->cursor(), dependents, MultipleSequenceReader(dependents)));
+		}
+
+		// non blocking consumer on the producers only, see EventPoller
+		std::shared_ptr<EventPoller<MyType, SingleBarrier> > newPoller() {
+			return std::shared_ptr<EventPoller<MyType, SingleBarrier> >(new EventPoller<MyType, SingleBarrier>(*this, newSingleBarrier()));
+		}
+
+		// non blocking consumer behind the consumers in [begin, end)
+		template<class SequenceIterator>
+		std::shared_ptr<EventPoller<MyType, MultipleBarrier> > newPoller(SequenceIterator begin, SequenceIterator end) {
+			return std::shared_ptr<EventPoller<MyType, MultipleBarrier> >(new EventPoller<MyType, MultipleBarrier>(*this, newMultipleBarrier(begin, end)));
 		}
 
 		seq_t cursorVal() {
-			return *Sequencer_t::cursor();
+			return *this->cursor();
 		}
 
 		bool hasAvailableCapacity(size_t requiredCapacity) {
-			HPRecord* rec = Sequencer_t::getHazardPointer();
-			const bool retVal = Sequencer_t::hasAvailableCapacity(rec->securePtr(m_gatingSequences), requiredCapacity);
-			Sequencer_t::releaseHazardPointer(rec);
-			return retVal;
+			return withGatingSequences([this, requiredCapacity](const GatingSequences& gating) {
+				return Sequencer_t::hasAvailableCapacity(gating, requiredCapacity);
+			});
 		}
 
 		T& preallocated(seq_t sequence) {
-			return m_entries[sequence & indexMask];
+			return m_entries[sequence].value;
 		}
 
 		void publish(seq_t sequence) {
+#ifdef CONCURRENT_INSTRUMENTATION
+			m_publishTimes[sequence & (capacity()-1)].store(Instrumentation::now(), std::memory_order_relaxed);
+#endif
 			Publisher_t::publish(sequence);
 		}
 
+		void publish(seq_t lo, seq_t hi) {
+#ifdef CONCURRENT_INSTRUMENTATION
+			const uint64_t now = Instrumentation::now();
+			for (seq_t sequence = lo; sequence <= hi; ++sequence) {
+				m_publishTimes[sequence & (capacity()-1)].store(now, std::memory_order_relaxed);
+			}
+#endif
+			Publisher_t::publish(lo, hi);
+		}
+
+#ifdef CONCURRENT_INSTRUMENTATION
+		// Instrumentation::now() when the slot was last published
+		uint64_t publishTime(seq_t sequence) const {
+			return m_publishTimes[sequence & (capacity()-1)].load(std::memory_order_relaxed);
+		}
+#endif
+
 		void publishAndAssign(const T& newVal) {
 			const seq_t seq = next();
 			preallocated(seq) = newVal;
-			Publisher_t::publish(seq);
+			publish(seq);
+		}
+
+		void publishAndAssign(T&& newVal) {
+			const seq_t seq = next();
+			preallocated(seq) = std::move(newVal);
+			publish(seq);
+		}
+
+		/* Claims a slot, lets the translator fill it in place and publishes it
+		 *
+		 *     ring.publishEvent([](Quote& q, seq_t, double bid, double ask) {
+		 *         q.bid = bid;
+		 *         q.ask = ask;
+		 *     }, bid, ask);
+		 *
+		 * The translator is called as translator(T& event, seq_t sequence, args...).
+		 * The slot is published even if it throws, otherwise the consumers
+		 * would stall on the claimed sequence forever.
+		 */
+		template<class Translator, class... Args>
+		void publishEvent(Translator&& translator, Args&&... args) {
+			translateAndPublish(next(), translator, std::forward<Args>(args)...);
+		}
+
+		// as publishEvent, but returns false instead of waiting when the ring is full
+		template<class Translator, class... Args>
+		bool tryPublishEvent(Translator&& translator, Args&&... args) {
+			seq_t seq;
+			try {
+				seq = tryNext();
+			} catch (const InsufficientCapacityException&) {
+				return false;
+			}
+			translateAndPublish(seq, translator, std::forward<Args>(args)...);
+			return true;
 		}
 
-		static const int bufferSize = (1 << POW);
+		/* Calls translator(T& event, seq_t sequence, *it) for every element
+		 * of [begin, end), claiming and publishing as many slots at a time
+		 * as the buffer allows.
+		 */
+		template<class Translator, class InputIterator>
+		void publishEvents(Translator&& translator, InputIterator begin, InputIterator end) {
+			size_t remaining = std::distance(begin, end);
+
+			while (remaining > 0) {
+				const size_t n = std::min(remaining, capacity());
+				const seq_t hi = next(n);
+				const seq_t lo = hi - (n - 1);
+
+				try {
+					for (seq_t seq = lo; seq <= hi; ++seq, ++begin) {
+						translator(preallocated(seq), seq, *begin);
+					}
+				} catch (...) {
+					publish(lo, hi);
+					throw;
+				}
+				publish(lo, hi);
+				remaining -= n;
+			}
+		}
+
+		/* Copies [begin, end) into the ring claiming and publishing as
+		 * many slots at a time as the buffer allows.
+		 */
+		template<class InputIterator>
+		void publishEvents(InputIterator begin, InputIterator end) {
+			size_t remaining = std::distance(begin, end);
+
+			while (remaining > 0) {
+				const size_t n = std::min(remaining, capacity());
+				const seq_t hi = next(n);
+				const seq_t lo = hi - (n - 1);
+
+				for (seq_t seq = lo; seq <= hi; ++seq, ++begin) {
+					preallocated(seq) = *begin;
+				}
+				publish(lo, hi);
+				remaining -= n;
+			}
+		}
+
+		// 0 if the size is only known at runtime, see capacity()
+		static const int bufferSize = RingEntries<RingEntry<T, PADDED_ENTRIES>, POW>::staticSize;
+
+		size_t capacity() const {
+			return Sequencer_t::bufferSize();
+		}
 
 
 		~RingBuffer() {
@@ -153,18 +406,71 @@ namespace disruptor {
 		RingBuffer()
 			: Sequencer_t(POW)
 			, Publisher_t(POW)
+			, m_entries(POW, MemoryOptions())
 			, m_gatingSequences(NULL)
+			, m_slots(new GatingSlots)
 		{
+			static_assert(POW != RUNTIME_SIZE, "a RingBuffer of RUNTIME_SIZE needs its size at construction");
+#ifdef CONCURRENT_INSTRUMENTATION
+			m_publishTimes.reset(new std::atomic<uint64_t>[capacity()]());
+#endif
 		}
 
-	private:
+		/* Ring of 2^bufferSizeLog2 entries allocated in one mapping that
+		 * can be backed by huge pages, prefaulted and locked in memory.
+		 */
+		RingBuffer(size_t bufferSizeLog2, const MemoryOptions& options = MemoryOptions())
+			: Sequencer_t(bufferSizeLog2)
+			, Publisher_t(bufferSizeLog2)
+			, m_entries(bufferSizeLog2, options)
+			, m_gatingSequences(NULL)
+			, m_slots(new GatingSlots)
+		{
+			static_assert(POW == RUNTIME_SIZE, "the size of this RingBuffer is fixed at compile time");
+#ifdef CONCURRENT_INSTRUMENTATION
+			m_publishTimes.reset(new std::atomic<uint64_t>[capacity()]());
+#endif
+		}
 
+	private:
 
+		/* Calls f with what the ring gates on. The hazard pointer is only
+		 * needed while sequences outside the slots gate the ring.
+		 */
+		template<class Function>
+		auto withGatingSequences(Function f) -> decltype(f(GatingSequences())) {
+			if (m_gatingSequences.load(std::memory_order_acquire) == NULL) {
+				return f(GatingSequences(m_slots.get(), NULL));
+			}
+			HPRecord* rec = Sequencer_t::getHazardPointer();
+			try {
+				auto retVal = f(GatingSequences(m_slots.get(), rec->securePtr(m_gatingSequences)));
+				Sequencer_t::releaseHazardPointer(rec);
+				return retVal;
+			} catch (...) {
+				Sequencer_t::releaseHazardPointer(rec);
+				throw;
+			}
+		}
 
-		static const int indexMask = (1 << POW)-1;
+		template<class Translator, class... Args>
+		void translateAndPublish(seq_t seq, Translator& translator, Args&&... args) {
+			try {
+				translator(preallocated(seq), seq, std::forward<Args>(args)...);
+			} catch (...) {
+				publish(seq);
+				throw;
+			}
+			publish(seq);
+		}
 
-		T m_entries[bufferSize];
-        std::atomic<SequenceArray*> m_gatingSequences;
+		alignas(CONCURRENT_CACHE_LINE_SIZE) RingEntries<RingEntry<T, PADDED_ENTRIES>, POW> m_entries;
+		alignas(CONCURRENT_CACHE_LINE_SIZE) std::atomic<SequenceArray*> m_gatingSequences;
+		std::shared_ptr<GatingSlots> m_slots;
+		std::shared_ptr<Sequence> m_slotOwners[GatingSlots::CAPACITY];
+#ifdef CONCURRENT_INSTRUMENTATION
+		std::unique_ptr<std::atomic<uint64_t>[]> m_publishTimes;
+#endif
 	};
 
 }
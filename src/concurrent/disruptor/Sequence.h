@@ -1,9 +1,11 @@
 #ifndef SEQUENCE_H
 #define SEQUENCE_H
 
+#include <algorithm>
 #include <atomic>
 #include <stdint.h>
 #include <memory>
+#include "CacheLine.h"
 
 namespace disruptor {
 
@@ -32,6 +34,11 @@ namespace disruptor {
             m_atomic = val;
 		}
 
+		// release store without the fence of changeValue, for a sequence that only its owner writes
+		void setOrdered(seq_t val) {
+            m_atomic.store(val, std::memory_order_release);
+		}
+
 		Sequence& operator=(seq_t val) {
 			changeValue(val);
 			return *this;
@@ -59,6 +66,26 @@ namespace disruptor {
 	};
 
 
+	/** Sequence that owns a whole cache line
+	 *
+	 *  Cursors and gating sequences are written by one thread and
+	 *  polled by others, so they must not share a line with anything
+	 *  else. Use it for every sequence that is embedded in a hot
+	 *  structure or allocated on its own.
+	 */
+	class alignas(CONCURRENT_CACHE_LINE_SIZE) PaddedSequence: public Sequence, public CacheAligned {
+	public:
+		PaddedSequence() {}
+
+		PaddedSequence(seq_t initialValue) : Sequence(initialValue) {}
+
+		PaddedSequence& operator=(seq_t val) {
+			changeValue(val);
+			return *this;
+		}
+	};
+
+
 	struct SequenceArray {
 
         typedef std::shared_ptr<Sequence>* iterator;
@@ -81,14 +108,21 @@ namespace disruptor {
 		const_iterator end() const { return begin() + size; }
 
 		static SequenceArray* build(size_t size) {
-			const size_t alloc = sizeof(Sequence*)*size+sizeof(SequenceArray);
+			const size_t alloc = sizeof(std::shared_ptr<Sequence>)*((size > 0) ? size-1 : 0)+sizeof(SequenceArray);
 			char* buffer = new char[alloc];
 			SequenceArray* ret = new(buffer) SequenceArray(size);
+			// sequences[0] is constructed as a member, the tail lives past the struct
+			for (size_t i = 1; i < size; ++i) {
+				new(&ret->sequences[i]) std::shared_ptr<Sequence>();
+			}
 			return ret;
 		}
 
 		static void destroy(void* holderPtr) {
 			SequenceArray* holder = reinterpret_cast<SequenceArray*>(holderPtr);
+			for (size_t i = 1; i < holder->size; ++i) {
+				holder->sequences[i].~shared_ptr<Sequence>();
+			}
 			holder->~SequenceArray();
 			delete[] reinterpret_cast<char*>(holder);
 		}
@@ -134,7 +168,7 @@ namespace disruptor {
 			SequenceArray* newArray = build(size);
 
 			for (size_t i = 0, j = 0; i < orig->size; ++i) {
-				if ((*orig)[i] == toRemove) {
+				if ((*orig)[i] != toRemove) {
 					(*newArray)[j++] = (*orig)[i];
 				}
 			}
@@ -169,6 +203,9 @@ namespace disruptor {
 
 
 	inline seq_t minimumSequence(const SequenceArray* sequences, seq_t minimum) {
+		if (sequences == NULL) {
+			return minimum;
+		}
 		SequenceArray::const_iterator it = sequences->begin();
 		SequenceArray::const_iterator end = sequences->end();
 		for (; it != end; ++it) {
@@ -186,12 +223,149 @@ namespace disruptor {
 		return minimumSequence(sequences, ~0-1);
 	}
 
+	/** Block of padded sequences that a ring scans for its minimum
+	 *
+	 *  A ring owns one block and hands its slots to consumers through
+	 *  RingBuffer::newSequence(). The producers find the minimum of the
+	 *  gating slots with one pass over adjacent cache lines instead of
+	 *  following a shared_ptr per consumer. A slot returns to the block
+	 *  when the last copy of its shared_ptr is gone, the block lives
+	 *  until the ring and every handed out sequence are gone.
+	 */
+	class GatingSlots: public CacheAligned {
+	public:
+
+		static const size_t CAPACITY = 16;
+
+		GatingSlots() : m_scanEnd(0) {
+			for (size_t i = 0; i < CAPACITY; ++i) {
+				m_slots[i].gating = false;
+				m_slots[i].used = false;
+			}
+		}
+
+		// a free slot, or an empty pointer when all of them are taken
+		static std::shared_ptr<Sequence> acquire(const std::shared_ptr<GatingSlots>& block) {
+			for (size_t i = 0; i < CAPACITY; ++i) {
+				Slot& slot = block->m_slots[i];
+				bool used = false;
+				if (!slot.used.load(std::memory_order_relaxed) && slot.used.compare_exchange_strong(used, true)) {
+					slot.sequence.changeValue(Sequence::INITIAL_CURSOR_VALUE);
+					return std::shared_ptr<Sequence>(&slot.sequence, Release(block, i));
+				}
+			}
+			return std::shared_ptr<Sequence>();
+		}
+
+		// slot of sequence, or CAPACITY if it does not live in this block
+		size_t indexOf(const Sequence* sequence) const {
+			for (size_t i = 0; i < CAPACITY; ++i) {
+				if (&m_slots[i].sequence == sequence) {
+					return i;
+				}
+			}
+			return CAPACITY;
+		}
+
+		void setGating(size_t index, bool gating) {
+			if (gating) {
+				size_t end = m_scanEnd.load();
+				while (end <= index && !m_scanEnd.compare_exchange_weak(end, index + 1)) {}
+			}
+			m_slots[index].gating.store(gating, std::memory_order_release);
+		}
+
+		bool gating() const {
+			const size_t end = m_scanEnd.load(std::memory_order_acquire);
+			for (size_t i = 0; i < end; ++i) {
+				if (m_slots[i].gating.load(std::memory_order_acquire)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/* Minimum over the gating slots shifted by one, which turns
+		 * INITIAL_CURSOR_VALUE into 0 and leaves ~0 for "nothing gates",
+		 * so the loop needs no early exit and no branch per slot.
+		 */
+		seq_t shiftedMinimum() const {
+			const size_t end = m_scanEnd.load(std::memory_order_acquire);
+			seq_t lowest = ~seq_t(0);
+			for (size_t i = 0; i < end; ++i) {
+				const seq_t shifted = m_slots[i].sequence.value() + 1;
+				lowest = std::min(lowest, m_slots[i].gating.load(std::memory_order_acquire) ? shifted : ~seq_t(0));
+			}
+			return lowest;
+		}
+
+	private:
+		GatingSlots(const GatingSlots&);
+		GatingSlots& operator=(const GatingSlots&);
+
+		// the consumer writes the sequence, the flags change only when consumers come and go
+		struct alignas(CONCURRENT_CACHE_LINE_SIZE) Slot {
+			Sequence sequence;
+			std::atomic<bool> gating;
+			std::atomic<bool> used;
+		};
+
+		struct Release {
+			Release(const std::shared_ptr<GatingSlots>& b, size_t i) : block(b), index(i) {}
+
+			void operator()(Sequence*) {
+				block->m_slots[index].gating.store(false);
+				block->m_slots[index].used.store(false, std::memory_order_release);
+			}
+
+			std::shared_ptr<GatingSlots> block;
+			size_t index;
+		};
+
+		Slot m_slots[CAPACITY];
+		// one past the highest slot that ever gated, the scan stops there
+		std::atomic<size_t> m_scanEnd;
+	};
+
+	// what the sequencers gate on: the ring's slots plus any other sequences
+	struct GatingSequences {
+		GatingSequences(const GatingSlots* s = NULL, const SequenceArray* o = NULL) : slots(s), others(o) {}
+
+		const GatingSlots* slots;
+		const SequenceArray* others;
+	};
+
+	inline seq_t minimumSequence(const GatingSequences& gating, seq_t minimum) {
+		if (gating.slots != NULL) {
+			const seq_t shifted = gating.slots->shiftedMinimum();
+			if (shifted == 0) {
+				return Sequence::INITIAL_CURSOR_VALUE;
+			}
+			if (shifted != ~seq_t(0)) {
+				minimum = std::min(minimum, shifted - 1);
+			}
+		}
+		return minimumSequence(gating.others, minimum);
+	}
+
+	/* INITIAL_CURSOR_VALUE is the unsigned image of -1, so a plain
+	 * comparison would rank it after every published sequence.
+	 * Shifting both sides by one restores the intended order.
+	 */
+	inline bool sequenceLess(seq_t a, seq_t b) {
+		return (a + 1) < (b + 1);
+	}
+
+	/* The readers are final so that code holding the concrete type,
+	 * like the wait strategy loops instantiated by StaticSequenceBarrier,
+	 * calls value() directly instead of through the vtable.
+	 */
 	struct MinimumReader {
 		virtual ~MinimumReader() {}
 		virtual seq_t value() const = 0;
 	};
 
-	struct OneSequenceReader: public MinimumReader {
+	struct OneSequenceReader final: public MinimumReader {
 		const Sequence* seq;
 		OneSequenceReader(Sequence* s) : seq(s) {}
 		seq_t value() const {
@@ -199,7 +373,7 @@ namespace disruptor {
 		}
 	};
 
-	struct MultipleSequenceReader: public MinimumReader {
+	struct MultipleSequenceReader final: public MinimumReader {
 		const SequenceArray* seqs;
 		MultipleSequenceReader(const SequenceArray* s) : seqs(s) {}
 		seq_t value() const {
@@ -20,6 +20,15 @@ namespace disruptor {
 		virtual ~AlertException() throw () {}
 	};
 
+	// thrown by wait strategies that give up waiting, see TimeoutBlockingWaitStrategy
+	class TimeoutException: public ExceptionLib::Exception {
+	public:
+		TimeoutException() : ExceptionBase(this, false, "TimeoutException", NULL) {}
+
+		TimeoutException(const TimeoutException& that) : ExceptionBase(that), Exception(that) {}
+		virtual ~TimeoutException() throw () {}
+	};
+
 	class SequenceBarrier {
 	public:
 		virtual ~SequenceBarrier() {}
@@ -39,7 +48,7 @@ namespace disruptor {
 	};
 
 	template<class WaitStrategy_t>
-	class ProcessingSequenceBarrier: public SequenceBarrier {
+	class ProcessingSequenceBarrier final: public SequenceBarrier {
 	public:
 
 		ProcessingSequenceBarrier(
@@ -65,11 +74,18 @@ namespace disruptor {
 		seq_t waitFor(seq_t sequence)
 		{
 			checkAlert();
+			// Without upstream consumers the barrier is bounded by the producers only
+			if (m_dependentSequences->size == 0) {
+				return m_waitStrategy->waitFor(sequence, m_cursorSequence, OneSequenceReader(m_cursorSequence), *this);
+			}
 			return m_waitStrategy->waitFor(sequence, m_cursorSequence, MultipleSequenceReader(m_dependentSequences), *this);
 		}
 
 		seq_t cursor() const
 		{
+			if (m_dependentSequences->size == 0) {
+				return OneSequenceReader(m_cursorSequence).value();
+			}
 			return MultipleSequenceReader(m_dependentSequences).value();
 		}
 
@@ -102,6 +118,85 @@ namespace disruptor {
 		volatile bool m_alerted;
 		Sequence* m_cursorSequence;
 	};
+
+	/** Barrier whose dependency reader is chosen at compile time
+	 *
+	 *  ProcessingSequenceBarrier decides per call between the cursor and
+	 *  the minimum over its dependents. This one fixes Reader_t up front,
+	 *  so the wait strategy loop is instantiated for the concrete reader
+	 *  and barrier. Processors that hold the barrier by its own type,
+	 *  e.g. BatchEventProcessor<Ring, Handler, Ring::SingleBarrier>, get
+	 *  the whole waitFor path inlined. Create them with
+	 *  RingBuffer::newSingleBarrier and RingBuffer::newMultipleBarrier.
+	 */
+	template<class WaitStrategy_t, class Reader_t>
+	class StaticSequenceBarrier final: public SequenceBarrier {
+	public:
+
+		// dependentSequences keeps alive what reader points to, it may be NULL
+		StaticSequenceBarrier(
+				WaitStrategy_t* waitStrategy,
+				Sequence* cursorSequence,
+				SequenceArray* dependentSequences,
+				const Reader_t& reader)
+			: m_waitStrategy(waitStrategy)
+			, m_dependentSequences(dependentSequences)
+			, m_reader(reader)
+			, m_alerted(false)
+			, m_cursorSequence(cursorSequence)
+		{
+
+		}
+
+		~StaticSequenceBarrier()
+		{
+			if (m_dependentSequences != NULL) {
+				SequenceArray::destroy(m_dependentSequences);
+				m_dependentSequences = NULL;
+			}
+		}
+
+		seq_t waitFor(seq_t sequence)
+		{
+			checkAlert();
+			return m_waitStrategy->waitFor(sequence, m_cursorSequence, m_reader, *this);
+		}
+
+		seq_t cursor() const
+		{
+			return m_reader.value();
+		}
+
+		bool alerted() const
+		{
+			return m_alerted;
+		}
+
+		void alert()
+		{
+			m_alerted = true;
+			m_waitStrategy->signalAllWhenBlocking();
+		}
+
+		void clearAlert()
+		{
+			m_alerted = false;
+		}
+
+		void checkAlert() const
+		{
+			if (m_alerted) {
+				throw AlertException();
+			}
+		}
+
+	private:
+		WaitStrategy_t* m_waitStrategy;
+		SequenceArray* m_dependentSequences;
+		const Reader_t m_reader;
+		volatile bool m_alerted;
+		Sequence* m_cursorSequence;
+	};
 }
 
 #endif // SEQUEENCEBARRIER_H
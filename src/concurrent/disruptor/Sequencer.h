@@ -8,6 +8,7 @@
 #include "WaitStrategy.h"
 #include "Sleep.h"
 #include "HazardPointers.h"
+#include "ProducerWaitStrategy.h"
 
 namespace disruptor {
 
@@ -22,18 +23,32 @@ namespace disruptor {
 		virtual ~InsufficientCapacityException() throw () {}
 	};
 
-	class SingleProducerSequencer {
+	inline void checkBatchSize(size_t n, size_t bufferSize) {
+		if (n < 1 || n > bufferSize) {
+			throw ExceptionLib::ProgrammingError("n must be greater than 0 and not exceed the buffer size");
+		}
+	}
+
+	/* The producer waits according to ProducerWait_t when the ring is full,
+	 * see ProducerWaitStrategy.h.
+	 *
+	 * Only the producer touches this state, keep it away from the neighbouring members of the ring
+	 */
+	template<class ProducerWait_t = YieldProducerWait>
+	class alignas(CONCURRENT_CACHE_LINE_SIZE) BasicSingleProducerSequencer: public ProducerWait_t {
 	public:
-		SingleProducerSequencer(size_t bufferSizeLog)
+		BasicSingleProducerSequencer(size_t bufferSizeLog)
 			: m_bufferSize((1 << bufferSizeLog))
 			, m_minGatingSequence(Sequence::INITIAL_CURSOR_VALUE)
 			, m_nextValue(Sequence::INITIAL_CURSOR_VALUE)
 			, m_hazardPtr(NULL)
 		{}
 
-		~SingleProducerSequencer() {
-			m_hazardPtr->releaseRecord();
-			m_hazardPtr = NULL;
+		~BasicSingleProducerSequencer() {
+			if (m_hazardPtr != NULL) {
+				m_hazardPtr->releaseRecord();
+				m_hazardPtr = NULL;
+			}
 		}
 
 		HPRecord* getHazardPointer() {
@@ -53,26 +68,17 @@ namespace disruptor {
 		}
 
 		bool hasAvailableCapacity(
-				SequenceArray*  gatingSequences, int requiredCapacity) const
+				const GatingSequences& gatingSequences, int requiredCapacity) const
 		{
 			const seq_t targetSequence = m_nextValue + requiredCapacity;
 
-			if (targetSequence == m_bufferSize) {
-				if (m_minGatingSequence == Sequence::INITIAL_CURSOR_VALUE) {
-					seq_t minSequence = minimumSequence(gatingSequences, m_nextValue);
-					m_minGatingSequence = minSequence;
-					if (minSequence == Sequence::INITIAL_CURSOR_VALUE)	{
-						return false;
-					}
-				}
-			}
-			if (targetSequence > m_bufferSize) {
+			if (targetSequence >= m_bufferSize) {
 				const seq_t wrapPoint = targetSequence - m_bufferSize;
-				if (wrapPoint > m_minGatingSequence) {
+				if (sequenceLess(m_minGatingSequence, wrapPoint)) {
 					const seq_t minSequence = minimumSequence(gatingSequences, m_nextValue);
 					m_minGatingSequence = minSequence;
 
-					if (wrapPoint > minSequence) {
+					if (sequenceLess(minSequence, wrapPoint)) {
 						return false;
 					}
 				}
@@ -81,29 +87,21 @@ namespace disruptor {
 		}
 
 
-		seq_t next(SequenceArray*  gatingSequences)
+		// Claims the next n slots and returns the highest of them
+		seq_t next(const GatingSequences& gatingSequences, size_t n = 1)
 		{
-			seq_t nextSequence = m_nextValue +1;
+			checkBatchSize(n, m_bufferSize);
 
-			if (nextSequence > m_bufferSize) {
+			const seq_t nextSequence = m_nextValue + n;
+
+			if (nextSequence >= m_bufferSize) {
 				const seq_t wrapPoint = nextSequence - m_bufferSize;
 				// Wrap point é onde o contador do producer vai bater no de um consumer
-				if (wrapPoint > m_minGatingSequence) {
+				if (sequenceLess(m_minGatingSequence, wrapPoint)) {
 					seq_t minSequence;
-					while(wrapPoint > (minSequence = minimumSequence(gatingSequences, m_nextValue))) {
-						// TODO: Use waitStrategy to spin?
-						SleepUtil::usleep(1);
-					}
-					m_minGatingSequence = minSequence;
-				}
-			} else
-			if (nextSequence == m_bufferSize) {
-				if (m_minGatingSequence == Sequence::INITIAL_CURSOR_VALUE) {
-					seq_t minSequence;
-					while((minSequence = minimumSequence(gatingSequences, m_nextValue)) == Sequence::INITIAL_CURSOR_VALUE) {
-						// TODO: Use waitStrategy to spin?
-						SleepUtil::usleep(1);
-					}
+					ProducerWait_t::waitForCapacity([&]() {
+						return !sequenceLess(minSequence = minimumSequence(gatingSequences, m_nextValue), wrapPoint);
+					});
 					m_minGatingSequence = minSequence;
 				}
 			}
@@ -113,16 +111,19 @@ namespace disruptor {
 		}
 
 
-		seq_t tryNext(SequenceArray* gatingSequences)
+		seq_t tryNext(const GatingSequences& gatingSequences, size_t n = 1)
 		{
-			if (!hasAvailableCapacity(gatingSequences, 1)) {
+			checkBatchSize(n, m_bufferSize);
+
+			if (!hasAvailableCapacity(gatingSequences, n)) {
 				throw InsufficientCapacityException();
 			}
-			return ++m_nextValue;
+			m_nextValue += n;
+			return m_nextValue;
 		}
 
 
-		size_t remainingCapacity(SequenceArray*  gatingSequences) const
+		size_t remainingCapacity(const GatingSequences& gatingSequences) const
 		{
 			seq_t consumed = minimumSequence(gatingSequences, m_nextValue);
 			seq_t produced = (m_nextValue == Sequence::INITIAL_CURSOR_VALUE) ? 0 : m_nextValue;
@@ -149,30 +150,37 @@ namespace disruptor {
 	};
 
 
-	class MultiProducerSequencer {
+	typedef BasicSingleProducerSequencer<> SingleProducerSequencer;
+
+
+	// The producers wait according to ProducerWait_t when the ring is full
+	template<class ProducerWait_t = YieldProducerWait>
+	class BasicMultiProducerSequencer: public ProducerWait_t {
 	public:
 
-		MultiProducerSequencer(size_t bufferSizeLog)
+		BasicMultiProducerSequencer(size_t bufferSizeLog)
 			: m_bufferSize((1 << bufferSizeLog))
 			, m_cursor(Sequence::INITIAL_CURSOR_VALUE)
-			, m_wrapPointCache(Sequence::INITIAL_CURSOR_VALUE)
+			// INITIAL_CURSOR_VALUE + bufferSize: the first lap needs no consumer
+			, m_wrapPointCache(Sequence::INITIAL_CURSOR_VALUE + m_bufferSize)
 		{}
 
-		~MultiProducerSequencer() {	}
+		~BasicMultiProducerSequencer() {	}
 
+		// every producer thread keeps its record instead of searching the pool per claim
 		HPRecord* getHazardPointer() {
-			return HPRecord::acquire();
+			return HPRecord::threadRecord();
 		}
 
 		void releaseHazardPointer(HPRecord* rec) {
-			rec->releaseRecord();
+			rec->releasePtr();
 		}
 
 		int bufferSize() const {
 			return m_bufferSize;
 		}
 
-		bool hasAvailableCapacity(SequenceArray* gatingSequences, int requiredCapacity) const
+		bool hasAvailableCapacity(const GatingSequences& gatingSequences, int requiredCapacity) const
 		{
 			const seq_t desiredSequence = m_cursor + requiredCapacity;
 			if (desiredSequence > m_wrapPointCache) {
@@ -185,36 +193,28 @@ namespace disruptor {
 			return true;
 		}
 
-		seq_t next(SequenceArray* gatingSequences)
+		// Claims the next n slots and returns the highest of them
+		seq_t next(const GatingSequences& gatingSequences, size_t n = 1)
 		{
+			checkBatchSize(n, m_bufferSize);
+
 			seq_t current;
 			seq_t next;
 
 			do {
 
 				current = m_cursor;
-				next = current + 1;
-
-				if (next == m_bufferSize && m_wrapPointCache == Sequence::INITIAL_CURSOR_VALUE) {
-
-					seq_t minSeq = minimumSequence(gatingSequences, m_cursor);
-
-					if (minSeq == Sequence::INITIAL_CURSOR_VALUE) {
-						SleepUtil::usleep(1);
-						continue;
-					}
-
-					seq_t wrapPoint = minSeq + m_bufferSize;
-					m_wrapPointCache = wrapPoint;
-				}
+				next = current + n;
 
 				if (next > m_wrapPointCache) {
 
-					seq_t wrapPoint = minimumSequence(gatingSequences, m_cursor) + m_bufferSize;
+					seq_t wrapPoint = minimumSequence(gatingSequences, current) + m_bufferSize;
 					m_wrapPointCache = wrapPoint;
 
 					if (next > wrapPoint) {
-						SleepUtil::usleep(1);
+						ProducerWait_t::waitForCapacity([&]() {
+							return next <= minimumSequence(gatingSequences, current) + m_bufferSize;
+						});
 						continue;
 					}
 				} else if (m_cursor.compareAndSet(current, next)) {
@@ -224,28 +224,21 @@ namespace disruptor {
 			return next;
 		}
 
-		seq_t tryNext(SequenceArray* gatingSequences)
+		seq_t tryNext(const GatingSequences& gatingSequences, size_t n = 1)
 		{
+			checkBatchSize(n, m_bufferSize);
+
 			seq_t current;
 			seq_t next;
 
 			do {
 
 				current = m_cursor;
-				next = current + 1;
-
-				if (next == m_bufferSize && m_wrapPointCache == Sequence::INITIAL_CURSOR_VALUE) {
-					seq_t wrapPoint = minimumSequence(gatingSequences, m_cursor) + m_bufferSize;
-					m_wrapPointCache = wrapPoint;
-
-					if (wrapPoint == Sequence::INITIAL_CURSOR_VALUE) {
-						throw InsufficientCapacityException();
-					}
-				}
+				next = current + n;
 
 				if (next > m_wrapPointCache) {
 
-					seq_t wrapPoint = minimumSequence(gatingSequences, m_cursor) + m_bufferSize;
+					seq_t wrapPoint = minimumSequence(gatingSequences, current) + m_bufferSize;
 					m_wrapPointCache = wrapPoint;
 
 					if (next > wrapPoint) {
@@ -256,7 +249,7 @@ namespace disruptor {
 			return next;
 		}
 
-		size_t remainingCapacity(SequenceArray* gatingSequences) const
+		size_t remainingCapacity(const GatingSequences& gatingSequences) const
 		{
 			const seq_t consumed = minimumSequence(gatingSequences, m_cursor);
 			const seq_t produced = m_cursor;
@@ -280,9 +273,11 @@ namespace disruptor {
 
 	private:
 		const size_t m_bufferSize;
-		Sequence m_cursor;
-		mutable Sequence m_wrapPointCache;
+		PaddedSequence m_cursor;
+		mutable PaddedSequence m_wrapPointCache;
 	};
+
+	typedef BasicMultiProducerSequencer<> MultiProducerSequencer;
 }
 
 #endif // SEQUENCER_H
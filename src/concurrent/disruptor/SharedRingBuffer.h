@@ -0,0 +1,441 @@
+#ifndef SHAREDRINGBUFFER_H
+#define SHAREDRINGBUFFER_H
+
+#include "CacheLine.h"
+#include "EventPoller.h"
+#include "Futex.h"
+#include "Sequence.h"
+#include "Sequencer.h"
+#include "SharedMemory.h"
+#include <exception/Exception.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <stdint.h>
+#include <unistd.h>
+
+namespace disruptor {
+
+	/* Layout of the shared region. Every process maps it at a different
+	 * address, so it holds sizes and sequences but no pointers:
+	 *
+	 *     SharedRingHeader | SharedConsumerSlot[maxConsumers] | availability flags | entries
+	 */
+	struct SharedRingHeader {
+		static const uint32_t MAGIC = 0x52494e47;
+		static const uint32_t VERSION = 1;
+
+		std::atomic<uint32_t> magic; // stored last by the creator
+		uint32_t version;
+		uint64_t entrySize;
+		uint64_t bufferSizeLog2;
+		uint64_t maxConsumers;
+
+		alignas(CONCURRENT_CACHE_LINE_SIZE) std::atomic<seq_t> claimCursor;
+		alignas(CONCURRENT_CACHE_LINE_SIZE) std::atomic<int> generation; // futex word of blocked consumers
+		std::atomic<int> waiters;
+	};
+
+	// every process must see the same atomics, a lock based one would use a lock private to each process
+	static_assert(ATOMIC_INT_LOCK_FREE == 2, "SharedRingBuffer needs lock free atomic ints");
+	static_assert(sizeof(seq_t) != sizeof(long) || ATOMIC_LONG_LOCK_FREE == 2, "SharedRingBuffer needs lock free atomic sequences");
+	static_assert(sizeof(seq_t) != sizeof(long long) || ATOMIC_LLONG_LOCK_FREE == 2, "SharedRingBuffer needs lock free atomic sequences");
+
+	// gating sequence of one consumer process
+	struct alignas(CONCURRENT_CACHE_LINE_SIZE) SharedConsumerSlot {
+		enum State { FREE, RESERVED, ATTACHED };
+
+		std::atomic<seq_t> sequence;
+		std::atomic<int> state;
+		std::atomic<int> pid;
+	};
+
+	/** Multi producer ring buffer in a named shared memory object
+	 *
+	 *  One process creates the ring, any other process on the host
+	 *  attaches to it by name and may produce, consume or both:
+	 *
+	 *      SharedRingBuffer<Quote> ring("/quotes", 16);      // creator
+	 *      SharedRingBuffer<Quote> ring("/quotes");          // everybody else
+	 *      SharedRingBuffer<Quote>::Consumer consumer(ring);
+	 *      consumer.poll(handler);
+	 *
+	 *  T is copied between address spaces byte by byte, so it must be
+	 *  trivially copyable. Producers gate on the consumers attached at
+	 *  the moment, a consumer starts after the events claimed when it
+	 *  attaches. Blocked consumers sleep on a process shared futex.
+	 *
+	 *  The name outlives the processes, remove it with remove(name).
+	 */
+	template<class T>
+	class SharedRingBuffer {
+		static_assert(std::is_trivially_copyable<T>::value, "SharedRingBuffer entries must be trivially copyable");
+		static_assert(alignof(T) <= CONCURRENT_CACHE_LINE_SIZE, "SharedRingBuffer entries must not be over aligned");
+
+	public:
+
+		// creates the ring, fails if the name is taken
+		SharedRingBuffer(const std::string& name, size_t bufferSizeLog2, size_t maxConsumers = 8, const MemoryOptions& options = MemoryOptions())
+			: m_memory(new SharedMemory(name, regionSize(bufferSizeLog2, maxConsumers), SharedMemory::CREATE, options))
+		{
+			char* base = static_cast<char*>(m_memory->data());
+			SharedRingHeader* header = new(base) SharedRingHeader;
+			header->version = SharedRingHeader::VERSION;
+			header->entrySize = sizeof(T);
+			header->bufferSizeLog2 = bufferSizeLog2;
+			header->maxConsumers = maxConsumers;
+			header->claimCursor = Sequence::INITIAL_CURSOR_VALUE;
+			header->generation = 0;
+			header->waiters = 0;
+
+			SharedConsumerSlot* slots = reinterpret_cast<SharedConsumerSlot*>(base + slotsOffset());
+			for (size_t i = 0; i < maxConsumers; ++i) {
+				SharedConsumerSlot* slot = new(&slots[i]) SharedConsumerSlot;
+				slot->sequence = Sequence::INITIAL_CURSOR_VALUE;
+				slot->state = SharedConsumerSlot::FREE;
+				slot->pid = 0;
+			}
+
+			std::atomic<int>* flags = reinterpret_cast<std::atomic<int>*>(base + flagsOffset(maxConsumers));
+			for (size_t i = 0; i < (size_t(1) << bufferSizeLog2); ++i) {
+				new(&flags[i]) std::atomic<int>(-1);
+			}
+
+			header->magic.store(SharedRingHeader::MAGIC);
+			map();
+		}
+
+		// attaches to a ring created by another process
+		explicit SharedRingBuffer(const std::string& name, const MemoryOptions& options = MemoryOptions())
+		{
+			// the creator may still be sizing and initialising the region
+			const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+			m_memory.reset(new SharedMemory(name, 0, SharedMemory::OPEN, options, deadline));
+			if (m_memory->size() < sizeof(SharedRingHeader)) {
+				throw ExceptionLib::InvalidStateException("the shared memory object is not a ring buffer");
+			}
+			SharedRingHeader* header = static_cast<SharedRingHeader*>(m_memory->data());
+
+			while (header->magic.load() != SharedRingHeader::MAGIC) {
+				if (std::chrono::steady_clock::now() > deadline) {
+					throw ExceptionLib::InvalidStateException("the shared memory object is not a ring buffer");
+				}
+				std::this_thread::yield();
+			}
+
+			if (header->version != SharedRingHeader::VERSION
+					|| header->entrySize != sizeof(T)
+					|| m_memory->size() < regionSize(header->bufferSizeLog2, header->maxConsumers)) {
+				throw ExceptionLib::InvalidStateException("the ring buffer was created with a different layout or version");
+			}
+			map();
+		}
+
+		// unmaps the region, the ring stays available to the other processes
+		~SharedRingBuffer() {}
+
+		static void remove(const std::string& name) {
+			SharedMemory::unlink(name);
+		}
+
+		size_t capacity() const {
+			return m_bufferSize;
+		}
+
+		size_t maxConsumers() const {
+			return m_header->maxConsumers;
+		}
+
+		// producer, claims n contiguous slots and returns the highest of them
+		seq_t next(size_t n = 1) {
+			checkBatchSize(n, m_bufferSize);
+			const seq_t current = m_header->claimCursor.fetch_add(n);
+			const seq_t nextSequence = current + n;
+
+			while (sequenceLess(minimumGatingSequence(current) + m_bufferSize, nextSequence)) {
+				std::this_thread::yield();
+			}
+			return nextSequence;
+		}
+
+		seq_t tryNext(size_t n = 1) {
+			checkBatchSize(n, m_bufferSize);
+			seq_t current;
+			seq_t nextSequence;
+			do {
+				current = m_header->claimCursor.load();
+				nextSequence = current + n;
+				if (sequenceLess(minimumGatingSequence(current) + m_bufferSize, nextSequence)) {
+					throw InsufficientCapacityException();
+				}
+			} while (!m_header->claimCursor.compare_exchange_weak(current, nextSequence));
+			return nextSequence;
+		}
+
+		T& preallocated(seq_t sequence) {
+			return m_entries[sequence & m_indexMask];
+		}
+
+		void publish(seq_t sequence) {
+			m_flags[sequence & m_indexMask].store(availabilityFlag(sequence), std::memory_order_release);
+			// the flag store must not pass the waiters load, see Consumer::waitFor
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			signalAllWhenBlocking();
+		}
+
+		void publish(seq_t lo, seq_t hi) {
+			for (seq_t sequence = lo; sequence <= hi; ++sequence) {
+				m_flags[sequence & m_indexMask].store(availabilityFlag(sequence), std::memory_order_release);
+			}
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			signalAllWhenBlocking();
+		}
+
+		void publishAndAssign(const T& newVal) {
+			const seq_t seq = next();
+			preallocated(seq) = newVal;
+			publish(seq);
+		}
+
+		// see RingBuffer::publishEvent
+		template<class Translator, class... Args>
+		void publishEvent(Translator&& translator, Args&&... args) {
+			const seq_t seq = next();
+			try {
+				translator(preallocated(seq), seq, std::forward<Args>(args)...);
+			} catch (...) {
+				publish(seq);
+				throw;
+			}
+			publish(seq);
+		}
+
+		// consumer
+		bool available(seq_t sequence) const {
+			return m_flags[sequence & m_indexMask].load(std::memory_order_acquire) == availabilityFlag(sequence);
+		}
+
+		seq_t highestPublishedSequence(seq_t lowerBound, seq_t availableSequence) const {
+			for (seq_t sequence = lowerBound; !sequenceLess(availableSequence, sequence); ++sequence) {
+				if (!available(sequence)) {
+					return sequence - 1;
+				}
+			}
+			return availableSequence;
+		}
+
+		seq_t cursorVal() const {
+			return m_header->claimCursor.load();
+		}
+
+		// process that holds a consumer slot, 0 if the slot is free
+		int consumerProcess(size_t slot) const {
+			return m_slots[slot].state.load() == SharedConsumerSlot::ATTACHED ? m_slots[slot].pid.load() : 0;
+		}
+
+		/* Frees the slot of a consumer that died without detaching,
+		 * otherwise the producers stay gated on it forever.
+		 */
+		void detachConsumer(size_t slot) {
+			if (slot >= m_header->maxConsumers) {
+				throw ExceptionLib::ProgrammingError("no such consumer slot in the ring buffer");
+			}
+			m_slots[slot].state.store(SharedConsumerSlot::FREE);
+		}
+
+		/** Gating slot of one consumer, held for the lifetime of the object
+		 *
+		 *  poll() works like EventPoller::poll, waitFor() blocks on the
+		 *  shared futex for at most the given time.
+		 */
+		class Consumer: public EventPollerBase {
+		public:
+
+			explicit Consumer(SharedRingBuffer& ring)
+				: m_ring(ring)
+				, m_slot(ring.reserveSlot())
+			{
+				SharedConsumerSlot& slot = m_ring.m_slots[m_slot];
+				slot.pid = getpid();
+				slot.sequence = m_ring.cursorVal();
+				slot.state.store(SharedConsumerSlot::ATTACHED);
+				// producers that claimed before seeing the slot may lap the first value
+				slot.sequence = m_ring.cursorVal();
+			}
+
+			~Consumer() {
+				m_ring.detachConsumer(m_slot);
+			}
+
+			size_t slot() const {
+				return m_slot;
+			}
+
+			seq_t sequence() const {
+				return m_ring.m_slots[m_slot].sequence.load();
+			}
+
+			// marks every event up to sequence as processed
+			void release(seq_t sequence) {
+				m_ring.m_slots[m_slot].sequence.store(sequence);
+			}
+
+			template<class Handler>
+			PollState poll(Handler& handler) {
+				const seq_t currentSequence = sequence();
+				seq_t nextSequence = currentSequence + 1;
+				const seq_t availableSequence = m_ring.highestPublishedSequence(nextSequence, m_ring.cursorVal());
+
+				if (!sequenceLess(availableSequence, nextSequence)) {
+					seq_t processedSequence = currentSequence;
+					try {
+						bool processNextEvent = true;
+						while (processNextEvent && !sequenceLess(availableSequence, nextSequence)) {
+							processNextEvent = handler.onEvent(m_ring.preallocated(nextSequence), nextSequence, nextSequence == availableSequence);
+							processedSequence = nextSequence++;
+						}
+					} catch (...) {
+						release(processedSequence);
+						throw;
+					}
+					release(processedSequence);
+					return PROCESSING;
+				}
+
+				if (!sequenceLess(m_ring.cursorVal(), nextSequence)) {
+					return GATING;
+				}
+				return IDLE;
+			}
+
+			/* Waits until sequence is published or timeoutUS passed and
+			 * returns the highest published sequence, which is below
+			 * sequence on a timeout.
+			 */
+			seq_t waitFor(seq_t sequence, size_t timeoutUS) {
+				seq_t availableSequence = m_ring.highestPublishedSequence(sequence, m_ring.cursorVal());
+				if (!sequenceLess(availableSequence, sequence)) {
+					return availableSequence;
+				}
+
+				SharedRingHeader* header = m_ring.m_header;
+				const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUS);
+				header->waiters.fetch_add(1);
+				// either we see the flag or the publisher sees us waiting
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				while (true) {
+					const int generation = header->generation.load();
+					availableSequence = m_ring.highestPublishedSequence(sequence, m_ring.cursorVal());
+					if (!sequenceLess(availableSequence, sequence)) {
+						break;
+					}
+					const std::chrono::steady_clock::duration remaining = deadline - std::chrono::steady_clock::now();
+					if (remaining <= std::chrono::steady_clock::duration::zero()) {
+						break;
+					}
+#ifdef __linux__
+					Futex::waitFor(&header->generation, generation, remaining, true);
+#else
+					std::this_thread::yield();
+#endif
+				}
+				header->waiters.fetch_sub(1);
+				return availableSequence;
+			}
+
+		private:
+			Consumer(const Consumer&);
+			Consumer& operator=(const Consumer&);
+
+			SharedRingBuffer& m_ring;
+			const size_t m_slot;
+		};
+
+	private:
+		SharedRingBuffer(const SharedRingBuffer&);
+		SharedRingBuffer& operator=(const SharedRingBuffer&);
+
+		static size_t roundUp(size_t value) {
+			return (value + CONCURRENT_CACHE_LINE_SIZE - 1) / CONCURRENT_CACHE_LINE_SIZE * CONCURRENT_CACHE_LINE_SIZE;
+		}
+
+		static size_t slotsOffset() {
+			return roundUp(sizeof(SharedRingHeader));
+		}
+
+		static size_t flagsOffset(size_t maxConsumers) {
+			return slotsOffset() + maxConsumers * sizeof(SharedConsumerSlot);
+		}
+
+		static size_t entriesOffset(size_t bufferSizeLog2, size_t maxConsumers) {
+			return roundUp(flagsOffset(maxConsumers) + (sizeof(std::atomic<int>) << bufferSizeLog2));
+		}
+
+		static size_t regionSize(size_t bufferSizeLog2, size_t maxConsumers) {
+			return entriesOffset(bufferSizeLog2, maxConsumers) + (sizeof(T) << bufferSizeLog2);
+		}
+
+		void map() {
+			char* base = static_cast<char*>(m_memory->data());
+			m_header = reinterpret_cast<SharedRingHeader*>(base);
+			m_slots = reinterpret_cast<SharedConsumerSlot*>(base + slotsOffset());
+			m_flags = reinterpret_cast<std::atomic<int>*>(base + flagsOffset(m_header->maxConsumers));
+			m_entries = reinterpret_cast<T*>(base + entriesOffset(m_header->bufferSizeLog2, m_header->maxConsumers));
+			m_bufferSize = size_t(1) << m_header->bufferSizeLog2;
+			m_indexMask = m_bufferSize - 1;
+			m_indexShift = m_header->bufferSizeLog2;
+		}
+
+		int availabilityFlag(seq_t sequence) const {
+			return static_cast<int>(sequence >> m_indexShift);
+		}
+
+		seq_t minimumGatingSequence(seq_t minimum) const {
+			for (size_t i = 0; i < m_header->maxConsumers; ++i) {
+				if (m_slots[i].state.load() == SharedConsumerSlot::ATTACHED) {
+					const seq_t value = m_slots[i].sequence.load();
+					if (sequenceLess(value, minimum)) {
+						minimum = value;
+					}
+				}
+			}
+			return minimum;
+		}
+
+		size_t reserveSlot() {
+			for (size_t i = 0; i < m_header->maxConsumers; ++i) {
+				int expected = SharedConsumerSlot::FREE;
+				if (m_slots[i].state.compare_exchange_strong(expected, SharedConsumerSlot::RESERVED)) {
+					return i;
+				}
+			}
+			throw ExceptionLib::InvalidStateException("all consumer slots of the ring buffer are taken");
+		}
+
+		void signalAllWhenBlocking() {
+			if (m_header->waiters.load() != 0) {
+				m_header->generation.fetch_add(1);
+#ifdef __linux__
+				Futex::wake(&m_header->generation, INT_MAX, true);
+#endif
+			}
+		}
+
+		std::unique_ptr<SharedMemory> m_memory;
+		SharedRingHeader* m_header;
+		SharedConsumerSlot* m_slots;
+		std::atomic<int>* m_flags;
+		T* m_entries;
+		size_t m_bufferSize;
+		size_t m_indexMask;
+		size_t m_indexShift;
+	};
+
+}
+
+#endif // SHAREDRINGBUFFER_H
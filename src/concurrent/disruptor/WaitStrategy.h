@@ -6,34 +6,47 @@
 #include <chrono>
 #include <thread>
 #include <condition_variable>
+#include <atomic>
 
 #include "SequenceBarrier.h"
 #include "Sleep.h"
+#include "Futex.h"
 
 namespace disruptor {
 
+	/* Every strategy provides
+	 *
+	 *     template<class Reader_t, class Barrier_t>
+	 *     seq_t waitFor(seq_t sequence, Sequence* cursor, const Reader_t& dependents, Barrier_t& barrier);
+	 *     void signalAllWhenBlocking();
+	 *
+	 * waitFor is a template so that a barrier passing its concrete reader
+	 * and itself gets the whole wait loop inlined, see StaticSequenceBarrier.
+	 */
+
 	class BlockingWaitStrategy {
 	public:
 
 		BlockingWaitStrategy(size_t timeout = 1) : m_timeoutMS(timeout) {}
 
+		template<class Reader_t, class Barrier_t>
 		seq_t waitFor (
 				seq_t sequence,
 				Sequence* cursor,
-				const MinimumReader& depedentSequence,
-				SequenceBarrier& barrier)
+				const Reader_t& depedentSequence,
+				Barrier_t& barrier)
 		{
 			seq_t availableSequence;
-			if ((availableSequence = (*cursor)) < sequence) {
+			if (sequenceLess(availableSequence = (*cursor), sequence)) {
 
                 std::unique_lock<std::mutex> lock(m_lock);
 
-				while ((availableSequence = (*cursor)) < sequence) {
+				while (sequenceLess(availableSequence = (*cursor), sequence)) {
 					barrier.checkAlert();
                     m_processorNotifyCondition.wait_for(lock, std::chrono::milliseconds(m_timeoutMS));
 				}
 			}
-			while ((availableSequence = depedentSequence.value()) < sequence) {
+			while (sequenceLess(availableSequence = depedentSequence.value(), sequence)) {
 				barrier.checkAlert();
 			}
 			return availableSequence;
@@ -53,19 +66,196 @@ namespace disruptor {
 		size_t m_timeoutMS;
 	};
 
+	/** Blocking strategy that only signals when a consumer is parked
+	 *
+	 *  Publishers pay an atomic exchange instead of a notify_all per
+	 *  publish. The waiter raises m_signalNeeded before re-checking the
+	 *  cursor under the lock, so a wake up can't be lost and no timed
+	 *  polling is necessary.
+	 */
+	class LiteBlockingWaitStrategy {
+	public:
+
+		LiteBlockingWaitStrategy() : m_signalNeeded(false) {}
+
+		template<class Reader_t, class Barrier_t>
+		seq_t waitFor (
+				seq_t sequence,
+				Sequence* cursor,
+				const Reader_t& depedentSequence,
+				Barrier_t& barrier)
+		{
+			seq_t availableSequence;
+			if (sequenceLess(availableSequence = (*cursor), sequence)) {
+
+				std::unique_lock<std::mutex> lock(m_lock);
+
+				while (true) {
+					m_signalNeeded.store(true);
+					if (!sequenceLess(availableSequence = (*cursor), sequence)) {
+						break;
+					}
+					barrier.checkAlert();
+					m_processorNotifyCondition.wait(lock);
+				}
+			}
+			while (sequenceLess(availableSequence = depedentSequence.value(), sequence)) {
+				barrier.checkAlert();
+			}
+			return availableSequence;
+		}
+
+		void signalAllWhenBlocking() {
+			if (m_signalNeeded.exchange(false)) {
+				// here the lock is needed: the waiter may be between its check and the wait
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_processorNotifyCondition.notify_all();
+			}
+		}
+
+	private:
+		std::mutex m_lock;
+		std::condition_variable m_processorNotifyCondition;
+		std::atomic<bool> m_signalNeeded;
+	};
+
+	/** Lite blocking strategy that gives up after a timeout
+	 *
+	 *  Instead of waiting forever it throws TimeoutException, which the
+	 *  processors forward to the handler's onTimeout(seq_t) if it has one,
+	 *  so idle consumers can flush or send heartbeats.
+	 */
+	class TimeoutBlockingWaitStrategy {
+	public:
+
+		TimeoutBlockingWaitStrategy(size_t timeoutUS = 1000)
+			: m_timeout(std::chrono::microseconds(timeoutUS))
+			, m_signalNeeded(false)
+		{}
+
+		void setTimeout(std::chrono::nanoseconds timeout) {
+			m_timeout = timeout;
+		}
+
+		template<class Reader_t, class Barrier_t>
+		seq_t waitFor (
+				seq_t sequence,
+				Sequence* cursor,
+				const Reader_t& depedentSequence,
+				Barrier_t& barrier)
+		{
+			seq_t availableSequence;
+			if (sequenceLess(availableSequence = (*cursor), sequence)) {
+
+				const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + m_timeout;
+				std::unique_lock<std::mutex> lock(m_lock);
+
+				while (true) {
+					m_signalNeeded.store(true);
+					if (!sequenceLess(availableSequence = (*cursor), sequence)) {
+						break;
+					}
+					barrier.checkAlert();
+					if (m_processorNotifyCondition.wait_until(lock, deadline) == std::cv_status::timeout) {
+						if (sequenceLess(availableSequence = (*cursor), sequence)) {
+							throw TimeoutException();
+						}
+					}
+				}
+			}
+			while (sequenceLess(availableSequence = depedentSequence.value(), sequence)) {
+				barrier.checkAlert();
+			}
+			return availableSequence;
+		}
+
+		void signalAllWhenBlocking() {
+			if (m_signalNeeded.exchange(false)) {
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_processorNotifyCondition.notify_all();
+			}
+		}
+
+	private:
+		std::mutex m_lock;
+		std::condition_variable m_processorNotifyCondition;
+		std::chrono::nanoseconds m_timeout;
+		std::atomic<bool> m_signalNeeded;
+	};
+
+#ifdef __linux__
+	/** Parks consumers directly on a futex word
+	 *
+	 *  Publishers only make the wake syscall while someone is parked.
+	 *  The cursor is 64 bits wide, so waiters sleep on a 32 bit
+	 *  generation counter that is bumped on every wake up instead.
+	 */
+	class FutexWaitStrategy {
+	public:
+
+		FutexWaitStrategy() : m_generation(0), m_waiters(0) {}
+
+		template<class Reader_t, class Barrier_t>
+		seq_t waitFor (
+				seq_t sequence,
+				Sequence* cursor,
+				const Reader_t& depedentSequence,
+				Barrier_t& barrier)
+		{
+			seq_t availableSequence;
+			if (sequenceLess(availableSequence = (*cursor), sequence)) {
+
+				WaiterGuard guard(m_waiters);
+
+				while (true) {
+					const int generation = m_generation.load();
+					if (!sequenceLess(availableSequence = (*cursor), sequence)) {
+						break;
+					}
+					barrier.checkAlert();
+					Futex::wait(&m_generation, generation);
+				}
+			}
+			while (sequenceLess(availableSequence = depedentSequence.value(), sequence)) {
+				barrier.checkAlert();
+			}
+			return availableSequence;
+		}
+
+		void signalAllWhenBlocking() {
+			if (m_waiters.load() != 0) {
+				m_generation.fetch_add(1);
+				Futex::wake(&m_generation);
+			}
+		}
+
+	private:
+
+		struct WaiterGuard {
+			std::atomic<int>& waiters;
+			WaiterGuard(std::atomic<int>& w) : waiters(w) { waiters.fetch_add(1); }
+			~WaiterGuard() { waiters.fetch_sub(1); }
+		};
+
+		std::atomic<int> m_generation;
+		std::atomic<int> m_waiters;
+	};
+#endif
+
 	class SpinWaitStrategy {
 	public:
 
 		SpinWaitStrategy() {}
 
+		template<class Reader_t, class Barrier_t>
 		seq_t waitFor (
 				seq_t sequence,
 				Sequence* /*cursor*/,
-				const MinimumReader& depedentSequence,
-				SequenceBarrier& barrier)
+				const Reader_t& depedentSequence,
+				Barrier_t& barrier)
 		{
 			seq_t availableSequence;
-			while ((availableSequence = depedentSequence.value()) < sequence) {
+			while (sequenceLess(availableSequence = depedentSequence.value(), sequence)) {
 				barrier.checkAlert();
 			}
 			return availableSequence;
@@ -76,30 +266,33 @@ namespace disruptor {
 	private:
 	};
 
+	// Spins, then yields, then sleeps for sleepNS between checks
 	class SleepingWaitStrategy {
 	public:
 
-		SleepingWaitStrategy() {}
+		SleepingWaitStrategy(size_t sleepNS = 100) : m_sleepNS(sleepNS) {}
 
+		template<class Reader_t, class Barrier_t>
 		seq_t waitFor (
 				seq_t sequence,
 				Sequence* /*cursor*/,
-				const MinimumReader& depedentSequence,
-				SequenceBarrier& barrier)
+				const Reader_t& depedentSequence,
+				Barrier_t& barrier)
 		{
 			seq_t availableSequence;
 			int counter = 200;
 
-			while ((availableSequence = depedentSequence.value()) < sequence) {
+			while (sequenceLess(availableSequence = depedentSequence.value(), sequence)) {
 				barrier.checkAlert();
 
 				if (counter > 100) {
 					--counter;
+					SleepUtil::cpuRelax();
 				} else if (counter > 0) {
 					--counter;
                     std::this_thread::yield();
 				} else {
-
+					std::this_thread::sleep_for(std::chrono::nanoseconds(m_sleepNS));
 				}
 			}
 			return availableSequence;
@@ -108,28 +301,31 @@ namespace disruptor {
 		void signalAllWhenBlocking() {}
 
 	private:
+		size_t m_sleepNS;
 	};
 
+	// Spins for a short while, then yields between checks
 	class YieldingWaitStrategy {
 	public:
 
 		YieldingWaitStrategy() {}
 
+		template<class Reader_t, class Barrier_t>
 		seq_t waitFor (
 				seq_t sequence,
 				Sequence* /*cursor*/,
-				const MinimumReader& depedentSequence,
-				SequenceBarrier& barrier)
+				const Reader_t& depedentSequence,
+				Barrier_t& barrier)
 		{
 			seq_t availableSequence;
 			int counter = 100;
 
-			while ((availableSequence = depedentSequence.value()) < sequence) {
+			while (sequenceLess(availableSequence = depedentSequence.value(), sequence)) {
 				barrier.checkAlert();
-                if (counter == 0) {
-                    std::this_thread::yield();
+				if (counter == 0) {
+					std::this_thread::yield();
 				} else {
-					SleepUtil::usleep(1);
+					SleepUtil::cpuRelax();
 					--counter;
 				}
 			}
@@ -141,6 +337,78 @@ namespace disruptor {
 	private:
 	};
 
+
+	/** Spins, then yields, then falls back to another strategy
+	 *
+	 *  Each phase lasts for a configurable time. Spinning uses the CPU
+	 *  pause instruction and checks the clock only every SPIN_TRIES
+	 *  iterations. The fallback is usually a blocking strategy, so a
+	 *  quiet ring costs no CPU and a busy one no syscalls.
+	 */
+	template<class Fallback_t = LiteBlockingWaitStrategy>
+	class PhasedBackoffWaitStrategy {
+	public:
+
+		PhasedBackoffWaitStrategy(size_t spinUS = 10, size_t yieldUS = 100)
+			: m_spinTimeout(std::chrono::microseconds(spinUS))
+			, m_yieldTimeout(std::chrono::microseconds(spinUS + yieldUS))
+		{}
+
+		void setBackoff(std::chrono::nanoseconds spin, std::chrono::nanoseconds yield) {
+			m_spinTimeout = spin;
+			m_yieldTimeout = spin + yield;
+		}
+
+		Fallback_t& fallback() {
+			return m_fallback;
+		}
+
+		template<class Reader_t, class Barrier_t>
+		seq_t waitFor (
+				seq_t sequence,
+				Sequence* cursor,
+				const Reader_t& depedentSequence,
+				Barrier_t& barrier)
+		{
+			seq_t availableSequence;
+			std::chrono::steady_clock::time_point start;
+			bool started = false;
+			int counter = SPIN_TRIES;
+
+			while (sequenceLess(availableSequence = depedentSequence.value(), sequence)) {
+				barrier.checkAlert();
+
+				if (--counter > 0) {
+					SleepUtil::cpuRelax();
+					continue;
+				}
+				counter = SPIN_TRIES;
+
+				const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+				if (!started) {
+					start = now;
+					started = true;
+				} else if (now - start > m_yieldTimeout) {
+					return m_fallback.waitFor(sequence, cursor, depedentSequence, barrier);
+				} else if (now - start > m_spinTimeout) {
+					std::this_thread::yield();
+				}
+			}
+			return availableSequence;
+		}
+
+		void signalAllWhenBlocking() {
+			m_fallback.signalAllWhenBlocking();
+		}
+
+	private:
+		static const int SPIN_TRIES = 1000;
+
+		std::chrono::nanoseconds m_spinTimeout;
+		std::chrono::nanoseconds m_yieldTimeout;
+		Fallback_t m_fallback;
+	};
+
 }
 
 #endif // WAITSTRATEGY_H
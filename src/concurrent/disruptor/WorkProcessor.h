@@ -0,0 +1,117 @@
+#ifndef WORKPROCESSOR_H
+#define WORKPROCESSOR_H
+
+#include "EventProcessor.h"
+#include "Sequence.h"
+#include "SequenceBarrier.h"
+#include <exception/Exception.h>
+#include <atomic>
+#include <memory>
+
+namespace disruptor {
+
+	/** Consumer that competes with its siblings for the events of a ring
+	 *
+	 *  All processors of a pool share the work sequence and claim the
+	 *  next event with a CAS on it, so each event is handled by exactly
+	 *  one of them. The handler must provide
+	 *
+	 *      void onEvent(T& event);
+	 *
+	 *  The processor's own sequence trails the event it is working on,
+	 *  which is what producers must gate on.
+	 */
+	template<class RingBuffer_t, class Handler, class Barrier_t = SequenceBarrier>
+	class WorkProcessor: public EventProcessor {
+	public:
+
+		WorkProcessor(
+				RingBuffer_t& ring,
+				std::shared_ptr<Barrier_t> barrier,
+				Handler& handler,
+				std::shared_ptr<Sequence> workSequence)
+			: m_ring(ring)
+			, m_barrier(barrier)
+			, m_handler(handler)
+			, m_workSequence(workSequence)
+			, m_sequence(ring.newSequence())
+			, m_state(IDLE)
+		{}
+
+		std::shared_ptr<Sequence> sequence() const {
+			return m_sequence;
+		}
+
+		void halt() {
+			m_state = HALTED;
+			m_barrier->alert();
+		}
+
+		bool isRunning() const {
+			return m_state != IDLE;
+		}
+
+		void run() {
+			int expected = IDLE;
+			if (!m_state.compare_exchange_strong(expected, RUNNING)) {
+				if (expected == RUNNING) {
+					throw ExceptionLib::InvalidStateException("WorkProcessor is already running");
+				}
+				m_state = IDLE;
+				return;
+			}
+			m_barrier->clearAlert();
+
+			bool processedSequence = true;
+			seq_t cachedAvailableSequence = Sequence::INITIAL_CURSOR_VALUE;
+			seq_t nextSequence = m_sequence->value();
+
+			try {
+				while (true) {
+					try {
+						if (processedSequence) {
+							processedSequence = false;
+							do {
+								nextSequence = m_workSequence->value() + 1;
+								m_sequence->changeValue(nextSequence - 1);
+							} while (!m_workSequence->compareAndSet(nextSequence - 1, nextSequence));
+							m_ring.signalCapacity();
+						}
+
+						if (!sequenceLess(cachedAvailableSequence, nextSequence)) {
+							m_handler.onEvent(m_ring.get(nextSequence));
+							processedSequence = true;
+						} else {
+							cachedAvailableSequence = m_barrier->waitFor(nextSequence);
+						}
+
+					} catch (const TimeoutException&) {
+						notifyTimeout(m_handler, m_sequence->value(), 0);
+					} catch (const AlertException&) {
+						if (m_state == HALTED) {
+							break;
+						}
+					}
+				}
+			} catch (...) {
+				m_state = IDLE;
+				throw;
+			}
+			m_state = IDLE;
+		}
+
+	private:
+
+		enum State { IDLE, HALTED, RUNNING };
+
+		RingBuffer_t& m_ring;
+		std::shared_ptr<Barrier_t> m_barrier;
+		Handler& m_handler;
+		std::shared_ptr<Sequence> m_workSequence;
+		std::shared_ptr<Sequence> m_sequence;
+		std::atomic<int> m_state;
+	};
+
+}
+
+#endif // WORKPROCESSOR_H
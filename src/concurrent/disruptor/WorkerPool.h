@@ -0,0 +1,128 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include "WorkProcessor.h"
+#include "ThreadFactory.h"
+#include <exception/Exception.h>
+#include <thread>
+#include <vector>
+#include <memory>
+
+namespace disruptor {
+
+	/** A group of WorkProcessors sharing one work sequence
+	 *
+	 *  Every event of the ring is handled by exactly one of the handlers.
+	 *  The producers must gate on workerSequences():
+	 *
+	 *      std::vector<std::shared_ptr<Sequence>> seqs = pool.workerSequences();
+	 *      ring.addGatingSequences(seqs.begin(), seqs.end());
+	 */
+	template<class RingBuffer_t, class Handler, class Barrier_t = SequenceBarrier>
+	class WorkerPool {
+	public:
+
+		typedef WorkProcessor<RingBuffer_t, Handler, Barrier_t> Processor_t;
+
+		// one processor per handler in [firstHandler, lastHandler)
+		template<class HandlerIterator>
+		WorkerPool(
+				RingBuffer_t& ring,
+				std::shared_ptr<Barrier_t> barrier,
+				HandlerIterator firstHandler,
+				HandlerIterator lastHandler)
+			: m_ring(ring)
+			, m_workSequence(ring.newSequence())
+			, m_started(false)
+		{
+			for (HandlerIterator it = firstHandler; it != lastHandler; ++it) {
+				m_processors.push_back(std::shared_ptr<Processor_t>(new Processor_t(ring, barrier, *it, m_workSequence)));
+			}
+		}
+
+		~WorkerPool() {
+			if (m_started) {
+				halt();
+			}
+		}
+
+		// sequences of all workers plus the work sequence itself
+		std::vector<std::shared_ptr<Sequence> > workerSequences() const {
+			std::vector<std::shared_ptr<Sequence> > seqs;
+			for (size_t i = 0; i < m_processors.size(); ++i) {
+				seqs.push_back(m_processors[i]->sequence());
+			}
+			seqs.push_back(m_workSequence);
+			return seqs;
+		}
+
+		void start() {
+			ThreadFactory plain;
+			start(plain);
+		}
+
+		// one thread per handler, in handler order
+		void start(ThreadFactory& factory) {
+			if (m_started) {
+				throw ExceptionLib::InvalidStateException("WorkerPool has already been started");
+			}
+			m_started = true;
+
+			const seq_t cursor = m_ring.cursorVal();
+			m_workSequence->changeValue(cursor);
+
+			for (size_t i = 0; i < m_processors.size(); ++i) {
+				m_processors[i]->sequence()->changeValue(cursor);
+				std::shared_ptr<Processor_t> processor = m_processors[i];
+				m_threads.push_back(factory.newThread([processor](){ processor->run(); }));
+			}
+		}
+
+		// waits until the workers have caught up with the producers and stops them
+		void drainAndHalt() {
+			std::vector<std::shared_ptr<Sequence> > seqs = workerSequences();
+			while (sequenceLess(minimumOf(seqs), m_ring.cursorVal())) {
+				std::this_thread::yield();
+			}
+			halt();
+		}
+
+		void halt() {
+			for (size_t i = 0; i < m_processors.size(); ++i) {
+				m_processors[i]->halt();
+			}
+			for (size_t i = 0; i < m_threads.size(); ++i) {
+				m_threads[i].join();
+			}
+			m_threads.clear();
+			m_started = false;
+		}
+
+		bool isRunning() const {
+			return m_started;
+		}
+
+	private:
+		WorkerPool(const WorkerPool&);
+		WorkerPool& operator=(const WorkerPool&);
+
+		static seq_t minimumOf(const std::vector<std::shared_ptr<Sequence> >& seqs) {
+			seq_t minimum = seqs.front()->value();
+			for (size_t i = 1; i < seqs.size(); ++i) {
+				if (sequenceLess(seqs[i]->value(), minimum)) {
+					minimum = seqs[i]->value();
+				}
+			}
+			return minimum;
+		}
+
+		RingBuffer_t& m_ring;
+		std::shared_ptr<Sequence> m_workSequence;
+		std::vector<std::shared_ptr<Processor_t> > m_processors;
+		std::vector<std::thread> m_threads;
+		bool m_started;
+	};
+
+}
+
+#endif // WORKERPOOL_H
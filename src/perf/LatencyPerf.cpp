@@ -0,0 +1,344 @@
+#include "PerfReport.h"
+
+#include "Active.h"
+#include "HazardPointers.h"
+#include "Histogram.h"
+#include "Instrumentation.h"
+#include "MessageQueue.h"
+#include "Sleep.h"
+#include "disruptor/Disruptor.h"
+#include "disruptor/RingBuffer.h"
+#include "disruptor/WaitStrategy.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Round trip latency of a ping pong over two queues
+ *
+ * The driver sends at a fixed rate and waits for each echo before the
+ * next send. Round trips are measured from the time a message was due,
+ * not from when it actually went out, so a stall also charges the sends
+ * it delayed (coordinated omission). The uncorrected numbers, measured
+ * from the actual send, are reported next to them.
+ *
+ * Paths: two RingBuffers per wait strategy with an echoing Disruptor
+ * consumer, two Active objects (driver -> A -> B -> driver) and two
+ * MessageQueue<std::deque> with an echo thread.
+ */
+
+using namespace disruptor;
+
+namespace {
+
+	const size_t BUFFER_SIZE_LOG2 = 10;
+
+	struct ValueEvent {
+		long value;
+	};
+
+	void check(bool condition, const std::string& what) {
+		if (!condition) {
+			std::cerr << what << std::endl;
+			throw ExceptionLib::InvalidStateException("benchmark result is wrong");
+		}
+	}
+
+	// round trips of one run and of all runs of a scenario
+	struct RoundTrips {
+
+		void record(uint64_t intended, uint64_t sent, uint64_t received) {
+			run.record(received - intended);
+			corrected.record(received - intended);
+			uncorrected.record(received - sent);
+		}
+
+		Histogram run;
+		Histogram corrected;
+		Histogram uncorrected;
+	};
+
+	/** Sends events round trips at rate per second through path
+	 *
+	 *  Path provides void roundTrip(long value), which returns once the
+	 *  echo of value came back. A tenth of the events warms up first and
+	 *  is not recorded.
+	 */
+	template<class Path>
+	void pingPong(Path& path, long events, long rate, RoundTrips& roundTrips) {
+		// past the measured values, so no echo left from the warm up matches one of them
+		for (long i = 0; i < events / 10; ++i) {
+			path.roundTrip(events + i);
+		}
+
+		const uint64_t interval = rate > 0 ? 1000000000 / rate : 0;
+		const uint64_t start = Instrumentation::now();
+		for (long i = 0; i < events; ++i) {
+			const uint64_t intended = start + i * interval;
+			while (Instrumentation::now() < intended) {
+				std::this_thread::yield();
+			}
+			const uint64_t sent = Instrumentation::now();
+			path.roundTrip(i);
+			roundTrips.record(interval ? intended : sent, sent, Instrumentation::now());
+		}
+	}
+
+	// the driver publishes into pings, a consumer echoes every event into pongs
+	template<class WaitStrategy_t>
+	class RingPath {
+	public:
+
+		typedef RingBuffer<ValueEvent, RUNTIME_SIZE, WaitStrategy_t, SingleProducerSequencer, SingleProducerPublisher> Ring_t;
+
+		RingPath()
+			: m_pongs(BUFFER_SIZE_LOG2)
+			, m_received(new PaddedSequence)
+			, m_echo(m_pongs)
+			, m_pings(BUFFER_SIZE_LOG2)
+		{
+			m_pongs.addGatingSequence(m_received);
+			m_barrier = m_pongs.newSingleBarrier();
+			m_pings.handleEventsWith(m_echo);
+			m_pings.start();
+		}
+
+		~RingPath() {
+			m_pings.shutdown();
+		}
+
+		void roundTrip(long value) {
+			m_pings.ringBuffer().publishEvent([](ValueEvent& event, seq_t, long v) {
+				event.value = v;
+			}, value);
+
+			const seq_t sequence = m_received->value() + 1;
+			m_barrier->waitFor(sequence);
+			check(m_pongs.get(sequence).value == value, "ring echo out of order");
+			m_received->changeValue(sequence);
+			m_pongs.signalCapacity();
+		}
+
+	private:
+
+		struct Echo {
+			Echo(Ring_t& pongs) : m_pongs(pongs) {}
+
+			void onEvent(ValueEvent& event, seq_t, bool) {
+				m_pongs.publishEvent([](ValueEvent& pong, seq_t, long v) {
+					pong.value = v;
+				}, event.value);
+			}
+
+			Ring_t& m_pongs;
+		};
+
+		Ring_t m_pongs;
+		std::shared_ptr<Sequence> m_received;
+		std::shared_ptr<typename Ring_t::SingleBarrier> m_barrier;
+		Echo m_echo;
+		Disruptor<Ring_t> m_pings;
+	};
+
+	// parks on the semaphore between messages
+	std::shared_ptr< ::WaitStrategy> semaphoreWait() {
+		return std::shared_ptr< ::WaitStrategy>(new MessageWaitStrategy);
+	}
+
+	// never parks, for a core per Active
+	class YieldingActiveWait: public ::WaitStrategy {
+	public:
+		void wait() {
+			std::this_thread::yield();
+		}
+
+		void newData() {}
+	};
+
+	std::shared_ptr< ::WaitStrategy> yieldingWait() {
+		return std::shared_ptr< ::WaitStrategy>(new YieldingActiveWait);
+	}
+
+	class ActivePath {
+	public:
+
+		typedef Active<> Active_t;
+
+		ActivePath(std::shared_ptr< ::WaitStrategy> (*waitStrategy)())
+			: m_a(waitStrategy())
+			, m_b(waitStrategy())
+			, m_reply(-1)
+		{}
+
+		void roundTrip(long value) {
+			m_a.send(Active_t::MsgPtr(new Ping(*this, value)));
+			while (m_reply.load() != value) {
+				std::this_thread::yield();
+			}
+		}
+
+	private:
+
+		struct Pong: public Active_t::Message {
+			Pong(ActivePath& path, long value) : m_path(path), m_value(value) {}
+
+			bool execute() {
+				m_path.m_reply.store(m_value);
+				return false;
+			}
+
+			ActivePath& m_path;
+			const long m_value;
+		};
+
+		struct Ping: public Active_t::Message {
+			Ping(ActivePath& path, long value) : m_path(path), m_value(value) {}
+
+			bool execute() {
+				m_path.m_b.send(Active_t::MsgPtr(new Pong(m_path, m_value)));
+				return false;
+			}
+
+			ActivePath& m_path;
+			const long m_value;
+		};
+
+		Active_t m_a;
+		Active_t m_b;
+		std::atomic<long> m_reply;
+	};
+
+	class MessageQueuePath {
+	public:
+
+		MessageQueuePath()
+			: m_echo([this](){
+				while (true) {
+					const ValueEvent event = m_pings.pop();
+					if (event.value < 0) {
+						break;
+					}
+					m_pongs.push(event);
+				}
+			})
+		{}
+
+		~MessageQueuePath() {
+			const ValueEvent stop = { -1 };
+			m_pings.push(stop);
+			m_echo.join();
+		}
+
+		void roundTrip(long value) {
+			const ValueEvent event = { value };
+			m_pings.push(event);
+			check(m_pongs.pop().value == value, "MessageQueue echo out of order");
+		}
+
+	private:
+		MessageQueue<std::deque<ValueEvent> > m_pings;
+		MessageQueue<std::deque<ValueEvent> > m_pongs;
+		std::thread m_echo;
+	};
+
+	struct Scenario {
+		Scenario(const std::string& n, const std::string& s, std::function<void(long, long, RoundTrips&)> r)
+			: name(n), strategy(s), run(r) {}
+
+		std::string name;
+		std::string strategy;
+		std::function<void(long, long, RoundTrips&)> run;
+	};
+
+	template<class WaitStrategy_t>
+	void ringPingPong(long events, long rate, RoundTrips& roundTrips) {
+		RingPath<WaitStrategy_t> path;
+		pingPong(path, events, rate, roundTrips);
+	}
+
+	template<std::shared_ptr< ::WaitStrategy> (*WAIT)()>
+	void activePingPong(long events, long rate, RoundTrips& roundTrips) {
+		ActivePath path(WAIT);
+		pingPong(path, events, rate, roundTrips);
+	}
+
+	void queuePingPong(long events, long rate, RoundTrips& roundTrips) {
+		MessageQueuePath path;
+		pingPong(path, events, rate, roundTrips);
+	}
+
+	std::string percentiles(const RoundTrips& roundTrips) {
+		const Histogram::Snapshot corrected = roundTrips.corrected.snapshot();
+		const Histogram::Snapshot uncorrected = roundTrips.uncorrected.snapshot();
+		std::ostringstream out;
+		out << "\"p50\": " << corrected.percentile(50)
+			<< ", \"p99\": " << corrected.percentile(99)
+			<< ", \"p99.9\": " << corrected.percentile(99.9)
+			<< ", \"p99.99\": " << corrected.percentile(99.99)
+			<< ", \"max\": " << corrected.max()
+			<< ", \"uncorrected_p99\": " << uncorrected.percentile(99)
+			<< ", \"uncorrected_p99.99\": " << uncorrected.percentile(99.99)
+			<< ", \"uncorrected_max\": " << uncorrected.max();
+		return out.str();
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	PerfOptions options(100*1000, 10*1000);
+	options.parse(argc, argv);
+
+	std::vector<Scenario> scenarios;
+	scenarios.push_back(Scenario("ring", "blocking", &ringPingPong<BlockingWaitStrategy>));
+	scenarios.push_back(Scenario("ring", "lite-blocking", &ringPingPong<LiteBlockingWaitStrategy>));
+#ifdef __linux__
+	scenarios.push_back(Scenario("ring", "futex", &ringPingPong<FutexWaitStrategy>));
+#endif
+	scenarios.push_back(Scenario("ring", "sleeping", &ringPingPong<SleepingWaitStrategy>));
+	scenarios.push_back(Scenario("ring", "yielding", &ringPingPong<YieldingWaitStrategy>));
+	scenarios.push_back(Scenario("ring", "phased-backoff", &ringPingPong<PhasedBackoffWaitStrategy<> >));
+	// needs a core per thread
+	scenarios.push_back(Scenario("ring", "busy-spin", &ringPingPong<SpinWaitStrategy>));
+	scenarios.push_back(Scenario("active", "semaphore", &activePingPong<semaphoreWait>));
+	scenarios.push_back(Scenario("active", "yielding", &activePingPong<yieldingWait>));
+	scenarios.push_back(Scenario("queue", "MessageQueue<deque>", &queuePingPong));
+
+	PerfReport report("concurrent_latency", options);
+	int failures = 0;
+
+	for (size_t i = 0; i < scenarios.size(); ++i) {
+		const Scenario& scenario = scenarios[i];
+		const std::string name = scenario.name + "/" + scenario.strategy;
+		if (!options.selected(name)) {
+			continue;
+		}
+
+		// per run p99 as the samples, the percentiles over all runs as extras
+		RoundTrips roundTrips;
+		std::vector<double> samples;
+		try {
+			for (int run = 0; run < options.runs; ++run) {
+				roundTrips.run.reset();
+				scenario.run(options.events, options.rate, roundTrips);
+				samples.push_back(roundTrips.run.snapshot().percentile(99));
+				std::cerr << name << " run " << run << ": p99 " << long(samples.back()) << " ns" << std::endl;
+			}
+		} catch (...) {
+			std::cerr << name << " failed" << std::endl;
+			++failures;
+			continue;
+		}
+		report.add(scenario.name, scenario.strategy, "ns", samples, percentiles(roundTrips));
+	}
+
+	report.write();
+	HPRecord::retireThread();
+	return failures == 0 ? 0 : 1;
+}
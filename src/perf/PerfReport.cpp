@@ -0,0 +1,162 @@
+#include "PerfReport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+PerfOptions::PerfOptions(long defaultEvents, long defaultRate)
+	: runs(5)
+	, events(defaultEvents)
+	, rate(defaultRate)
+{
+}
+
+void PerfOptions::parse(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i) {
+		const bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--runs") == 0 && hasValue) {
+			runs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--events") == 0 && hasValue) {
+			events = atol(argv[++i]);
+		} else if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+			filter = argv[++i];
+		} else if (strcmp(argv[i], "--label") == 0 && hasValue) {
+			label = argv[++i];
+		} else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+			output = argv[++i];
+		} else if (strcmp(argv[i], "--rate") == 0 && hasValue) {
+			rate = atol(argv[++i]);
+		} else {
+			std::cerr << "usage: " << argv[0] << " [--runs N] [--events N] [--filter TEXT] [--label TEXT] [--output FILE] [--rate N]" << std::endl;
+			exit(2);
+		}
+	}
+	if (runs < 1 || events < 1) {
+		std::cerr << argv[0] << ": --runs and --events must be positive" << std::endl;
+		exit(2);
+	}
+	if (rate < 0) {
+		std::cerr << argv[0] << ": --rate must not be negative" << std::endl;
+		exit(2);
+	}
+}
+
+bool PerfOptions::selected(const std::string& name) const
+{
+	return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+
+PerfSummary::PerfSummary(const std::vector<double>& samples)
+	: mean(0)
+	, stddev(0)
+	, min(samples.empty() ? 0 : samples[0])
+	, max(min)
+{
+	if (samples.empty()) {
+		return;
+	}
+	for (size_t i = 0; i < samples.size(); ++i) {
+		mean += samples[i];
+		min = std::min(min, samples[i]);
+		max = std::max(max, samples[i]);
+	}
+	mean /= samples.size();
+
+	if (samples.size() > 1) {
+		double squares = 0;
+		for (size_t i = 0; i < samples.size(); ++i) {
+			squares += (samples[i] - mean) * (samples[i] - mean);
+		}
+		stddev = std::sqrt(squares / (samples.size() - 1));
+	}
+}
+
+
+PerfReport::PerfReport(const std::string& benchmark, const PerfOptions& options)
+	: m_benchmark(benchmark)
+	, m_options(options)
+{
+}
+
+void PerfReport::add(const std::string& scenario, const std::string& strategy, const std::string& unit,
+		const std::vector<double>& samples, const std::string& extra)
+{
+	const PerfSummary summary(samples);
+
+	std::ostringstream out;
+	out.precision(10);
+	out << "{\"scenario\": " << quote(scenario)
+		<< ", \"strategy\": " << quote(strategy)
+		<< ", \"unit\": " << quote(unit)
+		<< ", \"mean\": " << summary.mean
+		<< ", \"stddev\": " << summary.stddev
+		<< ", \"min\": " << summary.min
+		<< ", \"max\": " << summary.max
+		<< ", \"samples\": [";
+	for (size_t i = 0; i < samples.size(); ++i) {
+		out << (i ? ", " : "") << samples[i];
+	}
+	out << "]";
+	if (!extra.empty()) {
+		out << ", " << extra;
+	}
+	out << "}";
+	m_results.push_back(out.str());
+}
+
+void PerfReport::write(std::ostream& out) const
+{
+	out << "{\n"
+		<< "  \"benchmark\": " << quote(m_benchmark) << ",\n"
+		<< "  \"label\": " << quote(m_options.label) << ",\n"
+		<< "  \"runs\": " << m_options.runs << ",\n"
+		<< "  \"events\": " << m_options.events << ",\n";
+	if (m_options.rate > 0) {
+		out << "  \"rate\": " << m_options.rate << ",\n";
+	}
+	out << "  \"results\": [";
+	for (size_t i = 0; i < m_results.size(); ++i) {
+		out << (i ? ",\n    " : "\n    ") << m_results[i];
+	}
+	out << "\n  ]\n}\n";
+}
+
+void PerfReport::write() const
+{
+	if (m_options.output.empty()) {
+		write(std::cout);
+		return;
+	}
+	std::ofstream file(m_options.output.c_str());
+	write(file);
+	if (!file) {
+		std::cerr << "could not write " << m_options.output << std::endl;
+		exit(1);
+	}
+}
+
+std::string PerfReport::quote(const std::string& text)
+{
+	std::string quoted = "\"";
+	for (size_t i = 0; i < text.size(); ++i) {
+		const char c = text[i];
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+			quoted += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			quoted += escaped;
+		} else {
+			quoted += c;
+		}
+	}
+	return quoted + "\"";
+}
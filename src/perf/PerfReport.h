@@ -0,0 +1,75 @@
+#ifndef PERFREPORT_H
+#define PERFREPORT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/** Command line shared by the benchmark programs
+ *
+ *      --runs N       repetitions of every scenario, default 5
+ *      --events N     events per producer and run
+ *      --filter TEXT  only scenarios whose name contains TEXT
+ *      --label TEXT   copied into the report, e.g. a version
+ *      --output FILE  JSON report, default standard output
+ *      --rate N       messages per second, latency benchmarks only,
+ *                     0 sends back to back
+ */
+struct PerfOptions {
+
+	PerfOptions(long defaultEvents, long defaultRate = 0);
+
+	// exits with a usage message on bad arguments
+	void parse(int argc, char** argv);
+
+	bool selected(const std::string& name) const;
+
+	int runs;
+	long events;
+	long rate;
+	std::string filter;
+	std::string label;
+	std::string output;
+};
+
+// mean, standard deviation and range of the samples of one scenario
+struct PerfSummary {
+
+	PerfSummary(const std::vector<double>& samples);
+
+	double mean;
+	double stddev;
+	double min;
+	double max;
+};
+
+/** Collects results and writes them as one JSON document
+ *
+ *      { "benchmark": ..., "label": ..., "runs": ..., "events": ...,
+ *        "results": [ { "scenario": ..., "strategy": ..., "unit": ...,
+ *                       "mean": ..., "stddev": ..., "min": ..., "max": ...,
+ *                       "samples": [...], ...extra } ] }
+ */
+class PerfReport {
+public:
+
+	PerfReport(const std::string& benchmark, const PerfOptions& options);
+
+	// extra holds further "key": value pairs, already JSON encoded
+	void add(const std::string& scenario, const std::string& strategy, const std::string& unit,
+			const std::vector<double>& samples, const std::string& extra = std::string());
+
+	void write(std::ostream& out) const;
+
+	// writes to PerfOptions::output or standard output
+	void write() const;
+
+	static std::string quote(const std::string& text);
+
+private:
+	const std::string m_benchmark;
+	const PerfOptions m_options;
+	std::vector<std::string> m_results;
+};
+
+#endif // PERFREPORT_H
@@ -0,0 +1,347 @@
+#include "PerfReport.h"
+
+#include "HazardPointers.h"
+#include "MessageQueue.h"
+#include "disruptor/Disruptor.h"
+#include "disruptor/RingBuffer.h"
+#include "disruptor/WaitStrategy.h"
+#include "disruptor/WorkerPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Throughput of the LMAX performance test topologies
+ *
+ * Every scenario runs once per consumer wait strategy, the same
+ * topologies over MessageQueue<std::deque> give the baseline.
+ * The 4W scenarios have four writers store to neighbouring counters,
+ * packed into one cache line or padded to a line each.
+ * Progress goes to standard error, the JSON report to standard
+ * output or --output.
+ */
+
+using namespace disruptor;
+
+namespace {
+
+	// 64k entries, like the LMAX performance tests
+	const size_t BUFFER_SIZE_LOG2 = 16;
+
+	struct ValueEvent {
+		long value;
+	};
+
+	// every consumer sums what it sees, so lost or repeated events show up
+	struct SumHandler {
+		SumHandler() : sum(0) {}
+
+		void onEvent(ValueEvent& event, seq_t, bool) {
+			sum += event.value;
+		}
+
+		long sum;
+	};
+
+	struct SumWorkHandler {
+		SumWorkHandler() : sum(0) {}
+
+		void onEvent(ValueEvent& event) {
+			sum += event.value;
+		}
+
+		long sum;
+	};
+
+	long expectedSum(long events) {
+		return events * (events - 1) / 2;
+	}
+
+	void check(bool condition, const std::string& what) {
+		if (!condition) {
+			std::cerr << what << std::endl;
+			throw ExceptionLib::InvalidStateException("benchmark result is wrong");
+		}
+	}
+
+	template<class Function>
+	double opsPerSecond(long operations, Function run) {
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		run();
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return operations / elapsed.count();
+	}
+
+	// each producer publishes the values 0 .. events-1
+	template<class RingBuffer_t>
+	void produce(RingBuffer_t& ring, int producers, long events) {
+		std::vector<std::thread> threads;
+		for (int p = 0; p < producers; ++p) {
+			threads.push_back(std::thread([&ring, events](){
+				for (long i = 0; i < events; ++i) {
+					ring.publishEvent([](ValueEvent& event, seq_t, long value) {
+						event.value = value;
+					}, i);
+				}
+				HPRecord::retireThread();
+			}));
+		}
+		for (size_t p = 0; p < threads.size(); ++p) {
+			threads[p].join();
+		}
+	}
+
+	template<class WaitStrategy_t>
+	struct DisruptorScenarios {
+
+		typedef RingBuffer<ValueEvent, RUNTIME_SIZE, WaitStrategy_t, SingleProducerSequencer, SingleProducerPublisher> Single_t;
+		typedef RingBuffer<ValueEvent, RUNTIME_SIZE, WaitStrategy_t, MultiProducerSequencer, MultiProducerPublisher> Multi_t;
+
+		static double oneToOne(long events) {
+			SumHandler handler;
+			Disruptor<Single_t> disruptor(BUFFER_SIZE_LOG2);
+			disruptor.handleEventsWith(handler);
+			disruptor.start();
+
+			const double result = opsPerSecond(events, [&](){
+				produce(disruptor.ringBuffer(), 1, events);
+				disruptor.shutdown();
+			});
+			check(handler.sum == expectedSum(events), "1P1C lost events");
+			return result;
+		}
+
+		// every consumer sees every event
+		static double oneToThreeMulticast(long events) {
+			SumHandler handlers[3];
+			Disruptor<Single_t> disruptor(BUFFER_SIZE_LOG2);
+			disruptor.handleEventsWith(handlers[0], handlers[1], handlers[2]);
+			disruptor.start();
+
+			const double result = opsPerSecond(events, [&](){
+				produce(disruptor.ringBuffer(), 1, events);
+				disruptor.shutdown();
+			});
+			for (int i = 0; i < 3; ++i) {
+				check(handlers[i].sum == expectedSum(events), "1P3C multicast lost events");
+			}
+			return result;
+		}
+
+		static double threeToOne(long events) {
+			SumHandler handler;
+			Disruptor<Multi_t> disruptor(BUFFER_SIZE_LOG2);
+			disruptor.handleEventsWith(handler);
+			disruptor.start();
+
+			const double result = opsPerSecond(3 * events, [&](){
+				produce(disruptor.ringBuffer(), 3, events);
+				disruptor.shutdown();
+			});
+			check(handler.sum == 3 * expectedSum(events), "3P1C lost events");
+			return result;
+		}
+
+		static double pipeline(long events) {
+			SumHandler stages[3];
+			Disruptor<Single_t> disruptor(BUFFER_SIZE_LOG2);
+			disruptor.handleEventsWith(stages[0]).then(stages[1]).then(stages[2]);
+			disruptor.start();
+
+			const double result = opsPerSecond(events, [&](){
+				produce(disruptor.ringBuffer(), 1, events);
+				disruptor.shutdown();
+			});
+			for (int i = 0; i < 3; ++i) {
+				check(stages[i].sum == expectedSum(events), "pipeline lost events");
+			}
+			return result;
+		}
+
+		static double diamond(long events) {
+			SumHandler journaler;
+			SumHandler replicator;
+			SumHandler business;
+			Disruptor<Single_t> disruptor(BUFFER_SIZE_LOG2);
+			disruptor.handleEventsWith(journaler, replicator).then(business);
+			disruptor.start();
+
+			const double result = opsPerSecond(events, [&](){
+				produce(disruptor.ringBuffer(), 1, events);
+				disruptor.shutdown();
+			});
+			check(business.sum == expectedSum(events), "diamond lost events");
+			return result;
+		}
+
+		// every event goes to one of three competing workers
+		static double workerPool(long events) {
+			Single_t ring(BUFFER_SIZE_LOG2);
+			SumWorkHandler handlers[3];
+			WorkerPool<Single_t, SumWorkHandler> pool(ring, ring.newBarrier(), handlers, handlers + 3);
+			std::vector<std::shared_ptr<Sequence> > sequences = pool.workerSequences();
+			ring.addGatingSequences(sequences.begin(), sequences.end());
+			pool.start();
+
+			const double result = opsPerSecond(events, [&](){
+				produce(ring, 1, events);
+				pool.drainAndHalt();
+			});
+			check(handlers[0].sum + handlers[1].sum + handlers[2].sum == expectedSum(events), "worker pool lost events");
+			return result;
+		}
+	};
+
+	template<int PRODUCERS>
+	double queueToOne(long events) {
+		MessageQueue<std::deque<ValueEvent> > queue;
+		long sum = 0;
+
+		const double result = opsPerSecond(PRODUCERS * events, [&](){
+			std::vector<std::thread> threads;
+			for (int p = 0; p < PRODUCERS; ++p) {
+				threads.push_back(std::thread([&queue, events](){
+					for (long i = 0; i < events; ++i) {
+						ValueEvent event = { i };
+						queue.push(event);
+					}
+				}));
+			}
+			for (long i = 0; i < PRODUCERS * events; ++i) {
+				sum += queue.pop().value;
+			}
+			for (size_t p = 0; p < threads.size(); ++p) {
+				threads[p].join();
+			}
+		});
+		check(sum == PRODUCERS * expectedSum(events), "MessageQueue lost events");
+		return result;
+	}
+
+	const int WRITERS = 4;
+
+	// every writer stores 1 .. events into its own counter and reads nothing, so only the layout differs
+	template<class Store>
+	double writeOwnCounters(long events, Store store) {
+		return opsPerSecond(WRITERS * events, [&](){
+			std::vector<std::thread> threads;
+			for (int w = 0; w < WRITERS; ++w) {
+				threads.push_back(std::thread([&store, w, events](){
+					for (long i = 1; i <= events; ++i) {
+						store(w, i);
+					}
+				}));
+			}
+			for (size_t w = 0; w < threads.size(); ++w) {
+				threads[w].join();
+			}
+		});
+	}
+
+	// Sequence packs the counters into one line, PaddedSequence gives each its own
+	template<class Seq>
+	double ownSequences(long events) {
+		Seq sequences[WRITERS];
+		const double result = writeOwnCounters(events, [&sequences](int w, long i) {
+			sequences[w].setOrdered(i);
+		});
+		for (int w = 0; w < WRITERS; ++w) {
+			check(sequences[w].value() == seq_t(events), "false sharing writer lost stores");
+		}
+		return result;
+	}
+
+	// neighbouring ring entries, as producers claiming adjacent slots write them
+	template<bool PADDED_ENTRIES>
+	double ownEntries(long events) {
+		RingEntry<std::atomic<long>, PADDED_ENTRIES> entries[WRITERS];
+		for (int w = 0; w < WRITERS; ++w) {
+			entries[w].value = 0;
+		}
+		const double result = writeOwnCounters(events, [&entries](int w, long i) {
+			entries[w].value.store(i, std::memory_order_release);
+		});
+		for (int w = 0; w < WRITERS; ++w) {
+			check(entries[w].value == events, "false sharing writer lost stores");
+		}
+		return result;
+	}
+
+	struct Scenario {
+		Scenario(const std::string& n, const std::string& s, std::function<double(long)> r)
+			: name(n), strategy(s), run(r) {}
+
+		std::string name;
+		std::string strategy;
+		std::function<double(long)> run;
+	};
+
+	template<class WaitStrategy_t>
+	void addDisruptorScenarios(std::vector<Scenario>& scenarios, const std::string& strategy) {
+		typedef DisruptorScenarios<WaitStrategy_t> S;
+		scenarios.push_back(Scenario("1P1C", strategy, &S::oneToOne));
+		scenarios.push_back(Scenario("1P3C-multicast", strategy, &S::oneToThreeMulticast));
+		scenarios.push_back(Scenario("3P1C", strategy, &S::threeToOne));
+		scenarios.push_back(Scenario("1P3C-pipeline", strategy, &S::pipeline));
+		scenarios.push_back(Scenario("1P3C-diamond", strategy, &S::diamond));
+		scenarios.push_back(Scenario("1P3C-workerpool", strategy, &S::workerPool));
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	PerfOptions options(10*1000*1000);
+	options.parse(argc, argv);
+
+	std::vector<Scenario> scenarios;
+	addDisruptorScenarios<BlockingWaitStrategy>(scenarios, "blocking");
+	addDisruptorScenarios<LiteBlockingWaitStrategy>(scenarios, "lite-blocking");
+#ifdef __linux__
+	addDisruptorScenarios<FutexWaitStrategy>(scenarios, "futex");
+#endif
+	addDisruptorScenarios<SleepingWaitStrategy>(scenarios, "sleeping");
+	addDisruptorScenarios<YieldingWaitStrategy>(scenarios, "yielding");
+	addDisruptorScenarios<PhasedBackoffWaitStrategy<> >(scenarios, "phased-backoff");
+	// needs a core per thread, otherwise the spinning consumers starve the producer
+	addDisruptorScenarios<SpinWaitStrategy>(scenarios, "busy-spin");
+	scenarios.push_back(Scenario("1P1C", "MessageQueue<deque>", &queueToOne<1>));
+	scenarios.push_back(Scenario("3P1C", "MessageQueue<deque>", &queueToOne<3>));
+	scenarios.push_back(Scenario("4W-sequences", "packed", &ownSequences<Sequence>));
+	scenarios.push_back(Scenario("4W-sequences", "padded", &ownSequences<PaddedSequence>));
+	scenarios.push_back(Scenario("4W-entries", "packed", &ownEntries<false>));
+	scenarios.push_back(Scenario("4W-entries", "padded", &ownEntries<true>));
+
+	PerfReport report("concurrent_perf", options);
+	int failures = 0;
+
+	for (size_t i = 0; i < scenarios.size(); ++i) {
+		const Scenario& scenario = scenarios[i];
+		const std::string name = scenario.name + "/" + scenario.strategy;
+		if (!options.selected(name)) {
+			continue;
+		}
+
+		std::vector<double> samples;
+		try {
+			for (int run = 0; run < options.runs; ++run) {
+				samples.push_back(scenario.run(options.events));
+				std::cerr << name << " run " << run << ": " << long(samples.back()) << " ops/s" << std::endl;
+			}
+		} catch (...) {
+			std::cerr << name << " failed" << std::endl;
+			++failures;
+			continue;
+		}
+		report.add(scenario.name, scenario.strategy, "ops/s", samples);
+	}
+
+	report.write();
+	HPRecord::retireThread();
+	return failures == 0 ? 0 : 1;
+}
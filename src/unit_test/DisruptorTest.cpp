@@ -5,8 +5,33 @@
 #include "MessageQueue.h"
 #include <deque>
 #include <list>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <stdio.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
 
 #include "disruptor/RingBuffer.h"
+#include "disruptor/BatchEventProcessor.h"
+#include "disruptor/Disruptor.h"
+#include "disruptor/WorkerPool.h"
+#include "disruptor/SharedRingBuffer.h"
+#include "disruptor/JournalHandler.h"
+#include "Histogram.h"
+#include "ThreadFactory.h"
+#include "InlineActive.h"
+#include "PriorityActive.h"
+#include "ScheduledActive.h"
+#include "ThreadPool.h"
+#include <future>
+#include <pthread.h>
+#include <sched.h>
 
 using namespace disruptor;
 
@@ -136,3 +161,1937 @@ void DisruptorTest::test1P1CBlockingQueue()
 
     std::cout << (elapsed.count()) << " s" << std::endl;
 }
+
+
+struct CountdownHandler {
+
+	CountdownHandler(int count) : lastId(count), batches(0), done(false) {}
+
+	void onEvent(SimpleWork& work, seq_t, bool endOfBatch) {
+		TS_ASSERT_EQUALS(work.id, lastId-1);
+		lastId = work.id;
+		if (endOfBatch) {
+			++batches;
+		}
+		if (lastId == 0) {
+			done = true;
+		}
+	}
+
+	int lastId;
+	int batches;
+	std::atomic<bool> done;
+};
+
+
+void DisruptorTest::test1P1CBatchEventProcessor()
+{
+	static const int BUF = 11;
+	static const int COUNT = 10*1000*1000;
+
+	typedef RingBuffer<SimpleWork, BUF, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+
+	RingBuffer_t ring;
+	CountdownHandler handler(COUNT);
+	BatchEventProcessor<RingBuffer_t, CountdownHandler> processor(ring, ring.newBarrier(), handler);
+	ring.addGatingSequence(processor.sequence());
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	thread consumer([&](){
+		processor.run();
+		HPRecord::retireThread();
+	});
+
+	thread producer([&](int count){
+		while(count--) {
+			ring.publishAndAssign(count);
+		}
+		HPRecord::retireThread();
+	}, COUNT);
+
+	producer.join();
+	while (!handler.done) {
+		std::this_thread::yield();
+	}
+	processor.halt();
+	consumer.join();
+	HPRecord::retireThread();
+
+	TS_ASSERT_EQUALS(handler.lastId, 0);
+	TS_ASSERT_EQUALS(processor.sequence()->value(), seq_t(COUNT-1));
+	TS_ASSERT(!processor.isRunning());
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end-start;
+
+	std::cout << (elapsed.count()) << " s, " << handler.batches << " batches" << std::endl;
+}
+
+
+void DisruptorTest::testBatchClaim()
+{
+	typedef RingBuffer<SimpleWork, 4, SpinWaitStrategy, MultiProducerSequencer, MultiProducerPublisher> RingBuffer_t;
+
+	RingBuffer_t ring;
+	shared_ptr<Sequence> gatingSequence(new Sequence);
+	ring.addGatingSequence(gatingSequence);
+
+	TS_ASSERT_EQUALS(ring.next(10), seq_t(9));
+	ring.publish(0, 9);
+	TS_ASSERT_EQUALS(ring.tryNext(6), seq_t(15));
+	ring.publish(10, 15);
+	TS_ASSERT_THROWS(ring.tryNext(1), const InsufficientCapacityException&);
+
+	gatingSequence->changeValue(4);
+	TS_ASSERT(ring.hasAvailableCapacity(5));
+	TS_ASSERT(!ring.hasAvailableCapacity(6));
+	TS_ASSERT_EQUALS(ring.tryNext(5), seq_t(20));
+	ring.publish(16, 20);
+	TS_ASSERT_EQUALS(ring.cursorVal(), seq_t(20));
+
+	HPRecord::retireThread();
+}
+
+
+struct InterleavedHandler {
+
+	InterleavedHandler(int producers, int perProducer)
+		: lastIds(producers, -1), perProducer(perProducer), count(0) {}
+
+	void onEvent(SimpleWork& work, seq_t, bool) {
+		const int producer = work.id / perProducer;
+		TS_ASSERT_EQUALS(work.id, lastIds[producer] < 0 ? producer*perProducer : lastIds[producer]+1);
+		lastIds[producer] = work.id;
+		++count;
+	}
+
+	std::vector<int> lastIds;
+	int perProducer;
+	std::atomic<int> count;
+};
+
+
+void DisruptorTest::test3P1CBatchPublish()
+{
+	static const int BUF = 10;
+	static const int PRODUCERS = 3;
+	static const int PER_PRODUCER = 3*1000*1000;
+	static const int PACKET = 100;
+
+	typedef RingBuffer<SimpleWork, BUF, YieldingWaitStrategy, MultiProducerSequencer, MultiProducerPublisher> RingBuffer_t;
+
+	RingBuffer_t ring;
+	InterleavedHandler handler(PRODUCERS, PER_PRODUCER);
+	BatchEventProcessor<RingBuffer_t, InterleavedHandler> processor(ring, ring.newBarrier(), handler);
+	ring.addGatingSequence(processor.sequence());
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	thread consumer([&](){
+		processor.run();
+		HPRecord::retireThread();
+	});
+
+	std::vector<thread> producers;
+	for (int p = 0; p < PRODUCERS; ++p) {
+		producers.push_back(thread([&](int first){
+			std::vector<SimpleWork> packet;
+			for (int id = first; id < first + PER_PRODUCER; id += PACKET) {
+				packet.clear();
+				for (int i = id; i < std::min(id + PACKET, first + PER_PRODUCER); ++i) {
+					packet.push_back(SimpleWork(i));
+				}
+				ring.publishEvents(packet.begin(), packet.end());
+			}
+			HPRecord::retireThread();
+		}, p*PER_PRODUCER));
+	}
+
+	for (size_t p = 0; p < producers.size(); ++p) {
+		producers[p].join();
+	}
+	while (handler.count < PRODUCERS*PER_PRODUCER) {
+		std::this_thread::yield();
+	}
+	processor.halt();
+	consumer.join();
+	HPRecord::retireThread();
+
+	for (int p = 0; p < PRODUCERS; ++p) {
+		TS_ASSERT_EQUALS(handler.lastIds[p], (p+1)*PER_PRODUCER-1);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end-start;
+
+	std::cout << (elapsed.count()) << " s" << std::endl;
+}
+
+
+struct CountingHandler {
+	CountingHandler() : local(0), count(0) {}
+
+	void onEvent(SimpleWork&, seq_t, bool endOfBatch) {
+		++local;
+		if (endOfBatch) {
+			count = local;
+		}
+	}
+
+	int local;
+	std::atomic<int> count;
+};
+
+
+template<class RingBuffer_t>
+double runCountdown(int producers, int perProducer)
+{
+	std::unique_ptr<RingBuffer_t> ring(new RingBuffer_t);
+	CountingHandler handler;
+	BatchEventProcessor<RingBuffer_t, CountingHandler> processor(*ring, ring->newBarrier(), handler);
+	ring->addGatingSequence(processor.sequence());
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	thread consumer([&](){
+		processor.run();
+		HPRecord::retireThread();
+	});
+
+	std::vector<thread> threads;
+	for (int p = 0; p < producers; ++p) {
+		threads.push_back(thread([&](int count){
+			while(count--) {
+				ring->publishAndAssign(count);
+			}
+			HPRecord::retireThread();
+		}, perProducer));
+	}
+	for (size_t p = 0; p < threads.size(); ++p) {
+		threads[p].join();
+	}
+	while (handler.count < producers*perProducer) {
+		std::this_thread::yield();
+	}
+	processor.halt();
+	consumer.join();
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end-start;
+	return elapsed.count();
+}
+
+
+void DisruptorTest::testCacheLineLayout()
+{
+	static const size_t LINE = CONCURRENT_CACHE_LINE_SIZE;
+
+	TS_ASSERT_EQUALS(alignof(PaddedSequence), LINE);
+	TS_ASSERT_EQUALS(sizeof(PaddedSequence), LINE);
+	std::unique_ptr<PaddedSequence[]> sequences(new PaddedSequence[3]);
+	TS_ASSERT_EQUALS(reinterpret_cast<size_t>(&sequences[0]) % LINE, 0u);
+	TS_ASSERT_EQUALS(reinterpret_cast<char*>(&sequences[1]) - reinterpret_cast<char*>(&sequences[0]), ptrdiff_t(LINE));
+
+	typedef RingBuffer<SimpleWork, 4, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher, false> Packed_t;
+	typedef RingBuffer<SimpleWork, 4, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher, true> Padded_t;
+
+	std::unique_ptr<Packed_t> packed(new Packed_t);
+	TS_ASSERT_EQUALS(reinterpret_cast<char*>(&packed->preallocated(1)) - reinterpret_cast<char*>(&packed->preallocated(0)), ptrdiff_t(sizeof(SimpleWork)));
+
+	// every entry starts a line of its own
+	std::unique_ptr<Padded_t> padded(new Padded_t);
+	for (seq_t seq = 0; seq < 16; ++seq) {
+		TS_ASSERT_EQUALS(reinterpret_cast<size_t>(&padded->preallocated(seq)) % LINE, 0u);
+	}
+	TS_ASSERT_EQUALS(reinterpret_cast<char*>(&padded->preallocated(1)) - reinterpret_cast<char*>(&padded->preallocated(0)), ptrdiff_t(LINE));
+}
+
+
+void DisruptorTest::testRuntimeSizedRing()
+{
+	typedef RingBuffer<SimpleWork, RUNTIME_SIZE, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+
+	MemoryOptions options;
+	options.hugePages = MemoryOptions::TRANSPARENT_HUGE_PAGES;
+	options.prefault = true;
+
+	static const int LOG = 18;
+	RingBuffer_t ring(LOG, options);
+	TS_ASSERT_EQUALS(ring.capacity(), size_t(1) << LOG);
+
+	shared_ptr<Sequence> gatingSequence(new PaddedSequence);
+	ring.addGatingSequence(gatingSequence);
+
+	std::vector<SimpleWork> events;
+	for (int i = 0; i < (1 << LOG); ++i) {
+		events.push_back(SimpleWork(i));
+	}
+	ring.publishEvents(events.begin(), events.end());
+	TS_ASSERT(!ring.hasAvailableCapacity(1));
+
+	for (int i = 0; i < (1 << LOG); ++i) {
+		TS_ASSERT_EQUALS(ring.get(i).id, i);
+	}
+	gatingSequence->changeValue((1 << LOG) - 1);
+	TS_ASSERT_EQUALS(ring.next(), seq_t(1 << LOG));
+
+	MemoryOptions odd;
+	odd.hugePages = MemoryOptions::EXPLICIT_HUGE_PAGES;
+	odd.hugePageSize = 3*1024*1024;
+	TS_ASSERT_THROWS(MappedMemory(odd.hugePageSize, odd), const ExceptionLib::ProgrammingError&);
+
+	HPRecord::retireThread();
+}
+
+
+struct SummingWorkHandler {
+	SummingWorkHandler() : count(0), sum(0) {}
+
+	void onEvent(SimpleWork& work) {
+		++count;
+		sum += work.id;
+	}
+
+	long count;
+	long sum;
+};
+
+
+void DisruptorTest::test1P3CWorkerPool()
+{
+	static const int BUF = 10;
+	static const int COUNT = 3*1000*1000;
+
+	typedef RingBuffer<SimpleWork, BUF, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+
+	RingBuffer_t ring;
+	SummingWorkHandler handlers[3];
+	WorkerPool<RingBuffer_t, SummingWorkHandler> pool(ring, ring.newBarrier(), handlers, handlers+3);
+
+	std::vector<shared_ptr<Sequence> > sequences = pool.workerSequences();
+	ring.addGatingSequences(sequences.begin(), sequences.end());
+
+	auto start = std::chrono::high_resolution_clock::now();
+	pool.start();
+
+	for (int i = 1; i <= COUNT; ++i) {
+		ring.publishAndAssign(i);
+	}
+	pool.drainAndHalt();
+	HPRecord::retireThread();
+
+	long count = 0;
+	long sum = 0;
+	for (int i = 0; i < 3; ++i) {
+		count += handlers[i].count;
+		sum += handlers[i].sum;
+		std::cout << "worker " << i << ": " << handlers[i].count << " events" << std::endl;
+	}
+	TS_ASSERT_EQUALS(count, COUNT);
+	TS_ASSERT_EQUALS(sum, long(COUNT)*(COUNT+1)/2);
+	TS_ASSERT(!pool.isRunning());
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = end-start;
+
+	std::cout << (elapsed.count()) << " s" << std::endl;
+}
+
+
+struct StageHandler {
+	StageHandler(StageHandler* u1 = NULL, StageHandler* u2 = NULL) : processed(Sequence::INITIAL_CURSOR_VALUE), upstream1(u1), upstream2(u2) {}
+
+	void onEvent(SimpleWork&, seq_t sequence, bool) {
+		if (upstream1) {
+			TS_ASSERT(!sequenceLess(upstream1->processed, sequence));
+		}
+		if (upstream2) {
+			TS_ASSERT(!sequenceLess(upstream2->processed, sequence));
+		}
+		processed = sequence;
+	}
+
+	std::atomic<seq_t> processed;
+	StageHandler* upstream1;
+	StageHandler* upstream2;
+};
+
+
+void DisruptorTest::testDiamond()
+{
+	static const int BUF = 10;
+	static const int COUNT = 1000*1000;
+
+	typedef RingBuffer<SimpleWork, BUF, YieldingWaitStrategy, MultiProducerSequencer, MultiProducerPublisher> RingBuffer_t;
+
+	StageHandler journaler;
+	StageHandler replicator;
+	StageHandler business(&journaler, &replicator);
+	StageHandler reporter(&business);
+
+	Disruptor<RingBuffer_t> disruptor;
+	disruptor.handleEventsWith(journaler, replicator).then(business);
+	disruptor.after(business).then(reporter);
+	disruptor.start();
+
+	for (int i = 0; i < COUNT; ++i) {
+		disruptor.ringBuffer().publishAndAssign(i);
+	}
+	disruptor.shutdown();
+	HPRecord::retireThread();
+
+	TS_ASSERT_EQUALS(journaler.processed, seq_t(COUNT-1));
+	TS_ASSERT_EQUALS(replicator.processed, seq_t(COUNT-1));
+	TS_ASSERT_EQUALS(business.processed, seq_t(COUNT-1));
+	TS_ASSERT_EQUALS(reporter.processed, seq_t(COUNT-1));
+}
+
+
+void DisruptorTest::testBlockingWaitStrategies()
+{
+	static const int BUF = 10;
+	static const int COUNT = 1000*1000;
+
+	std::cout << "blocking 1P1C " << runCountdown<RingBuffer<SimpleWork, BUF, BlockingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> >(1, COUNT) << " s" << std::endl;
+	std::cout << "lite blocking 1P1C " << runCountdown<RingBuffer<SimpleWork, BUF, LiteBlockingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> >(1, COUNT) << " s" << std::endl;
+	std::cout << "lite blocking 3P1C " << runCountdown<RingBuffer<SimpleWork, BUF, LiteBlockingWaitStrategy, MultiProducerSequencer, MultiProducerPublisher> >(3, COUNT) << " s" << std::endl;
+#ifdef __linux__
+	std::cout << "futex 1P1C " << runCountdown<RingBuffer<SimpleWork, BUF, FutexWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> >(1, COUNT) << " s" << std::endl;
+	std::cout << "futex 3P1C " << runCountdown<RingBuffer<SimpleWork, BUF, FutexWaitStrategy, MultiProducerSequencer, MultiProducerPublisher> >(3, COUNT) << " s" << std::endl;
+#endif
+	HPRecord::retireThread();
+}
+
+
+struct HeartbeatHandler {
+	HeartbeatHandler() : events(0), timeouts(0) {}
+
+	void onEvent(SimpleWork&, seq_t, bool) {
+		++events;
+	}
+
+	void onTimeout(seq_t) {
+		++timeouts;
+	}
+
+	std::atomic<int> events;
+	std::atomic<int> timeouts;
+};
+
+
+void DisruptorTest::testBackoffWaitStrategies()
+{
+	static const int BUF = 10;
+	static const int COUNT = 1000*1000;
+
+	std::cout << "phased backoff 1P1C " << runCountdown<RingBuffer<SimpleWork, BUF, PhasedBackoffWaitStrategy<>, SingleProducerSequencer, SingleProducerPublisher> >(1, COUNT) << " s" << std::endl;
+	std::cout << "phased backoff 3P1C " << runCountdown<RingBuffer<SimpleWork, BUF, PhasedBackoffWaitStrategy<>, MultiProducerSequencer, MultiProducerPublisher> >(3, COUNT) << " s" << std::endl;
+	std::cout << "sleeping 1P1C " << runCountdown<RingBuffer<SimpleWork, BUF, SleepingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> >(1, COUNT) << " s" << std::endl;
+
+	typedef RingBuffer<SimpleWork, BUF, TimeoutBlockingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+
+	RingBuffer_t ring;
+	HeartbeatHandler handler;
+	BatchEventProcessor<RingBuffer_t, HeartbeatHandler> processor(ring, ring.newBarrier(), handler);
+	ring.addGatingSequence(processor.sequence());
+
+	thread consumer([&](){ processor.run(); });
+
+	while (handler.timeouts < 3) {
+		std::this_thread::yield();
+	}
+	for (int i = 0; i < 100; ++i) {
+		ring.publishAndAssign(i);
+	}
+	while (handler.events < 100) {
+		std::this_thread::yield();
+	}
+	processor.halt();
+	consumer.join();
+	HPRecord::retireThread();
+
+	TS_ASSERT_EQUALS(handler.events, 100);
+}
+
+
+void DisruptorTest::testProducerWaitStrategies()
+{
+	// small ring, so the producers wrap all the time
+	static const int BUF = 4;
+	static const int COUNT = 200*1000;
+
+	std::cout << "pause 1P1C " << runCountdown<RingBuffer<SimpleWork, BUF, LiteBlockingWaitStrategy, BasicSingleProducerSequencer<PauseProducerWait>, SingleProducerPublisher> >(1, COUNT) << " s" << std::endl;
+	std::cout << "yield 1P1C " << runCountdown<RingBuffer<SimpleWork, BUF, LiteBlockingWaitStrategy, BasicSingleProducerSequencer<YieldProducerWait>, SingleProducerPublisher> >(1, COUNT) << " s" << std::endl;
+	std::cout << "parking 1P1C " << runCountdown<RingBuffer<SimpleWork, BUF, LiteBlockingWaitStrategy, BasicSingleProducerSequencer<ParkingProducerWait>, SingleProducerPublisher> >(1, COUNT) << " s" << std::endl;
+	std::cout << "yield 3P1C " << runCountdown<RingBuffer<SimpleWork, BUF, LiteBlockingWaitStrategy, BasicMultiProducerSequencer<YieldProducerWait>, MultiProducerPublisher> >(3, COUNT) << " s" << std::endl;
+	std::cout << "parking 3P1C " << runCountdown<RingBuffer<SimpleWork, BUF, LiteBlockingWaitStrategy, BasicMultiProducerSequencer<ParkingProducerWait>, MultiProducerPublisher> >(3, COUNT) << " s" << std::endl;
+	HPRecord::retireThread();
+}
+
+
+void DisruptorTest::testStaticBarriers()
+{
+	static const int BUF = 10;
+	static const int COUNT = 1000*1000;
+
+	typedef RingBuffer<SimpleWork, BUF, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+	typedef BatchEventProcessor<RingBuffer_t, StageHandler, RingBuffer_t::SingleBarrier> SingleProcessor_t;
+	typedef BatchEventProcessor<RingBuffer_t, StageHandler, RingBuffer_t::MultipleBarrier> MultipleProcessor_t;
+
+	StageHandler first;
+	StageHandler second(&first);
+	StageHandler last(&first, &second);
+
+	RingBuffer_t ring;
+	SingleProcessor_t firstProcessor(ring, ring.newSingleBarrier(), first);
+	SingleProcessor_t secondProcessor(ring, ring.newSingleBarrier(firstProcessor.sequence()), second);
+	std::shared_ptr<Sequence> upstream[] = { firstProcessor.sequence(), secondProcessor.sequence() };
+	MultipleProcessor_t lastProcessor(ring, ring.newMultipleBarrier(upstream, upstream + 2), last);
+	ring.addGatingSequence(lastProcessor.sequence());
+
+	thread t1([&](){ firstProcessor.run(); HPRecord::retireThread(); });
+	thread t2([&](){ secondProcessor.run(); HPRecord::retireThread(); });
+	thread t3([&](){ lastProcessor.run(); HPRecord::retireThread(); });
+
+	for (int i = 0; i < COUNT; ++i) {
+		ring.publishAndAssign(i);
+	}
+	while (last.processed != seq_t(COUNT-1)) {
+		std::this_thread::yield();
+	}
+	firstProcessor.halt();
+	secondProcessor.halt();
+	lastProcessor.halt();
+	t1.join();
+	t2.join();
+	t3.join();
+	HPRecord::retireThread();
+
+	TS_ASSERT_EQUALS(first.processed, seq_t(COUNT-1));
+	TS_ASSERT_EQUALS(second.processed, seq_t(COUNT-1));
+}
+
+
+// the claim path before thread records, a pool search and a CAS per claim
+struct PooledRecordSequencer: public MultiProducerSequencer {
+	PooledRecordSequencer(size_t bufferSizeLog) : MultiProducerSequencer(bufferSizeLog) {}
+
+	HPRecord* getHazardPointer() {
+		return HPRecord::acquire();
+	}
+
+	void releaseHazardPointer(HPRecord* rec) {
+		rec->releaseRecord();
+	}
+};
+
+
+void DisruptorTest::test4P1CHazardRecords()
+{
+	static const int BUF = 11;
+	static const int COUNT = 2*1000*1000;
+	static const int PRODUCERS = 4;
+
+	typedef RingBuffer<SimpleWork, BUF, YieldingWaitStrategy, PooledRecordSequencer, MultiProducerPublisher> Pooled_t;
+	typedef RingBuffer<SimpleWork, BUF, YieldingWaitStrategy, MultiProducerSequencer, MultiProducerPublisher> Cached_t;
+
+	const double pooled = runCountdown<Pooled_t>(PRODUCERS, COUNT);
+	std::cout << "4P1C pooled records " << pooled << " s, " << (PRODUCERS*COUNT/pooled/1e6) << " Mops/s" << std::endl;
+	const double cached = runCountdown<Cached_t>(PRODUCERS, COUNT);
+	std::cout << "4P1C thread records " << cached << " s, " << (PRODUCERS*COUNT/cached/1e6) << " Mops/s" << std::endl;
+
+	// each producer thread reuses one record for all its claims
+	HPRecord* rec = HPRecord::threadRecord();
+	TS_ASSERT_EQUALS(rec, HPRecord::threadRecord());
+	HPRecord* other = NULL;
+	thread t([&](){ other = HPRecord::threadRecord(); });
+	t.join();
+	TS_ASSERT_DIFFERS(rec, other);
+	HPRecord::retireThread();
+}
+
+
+struct MarketData {
+	MarketData() : symbol(0), bid(0), ask(0), copies(0) {}
+
+	MarketData(const MarketData& that) : symbol(that.symbol), bid(that.bid), ask(that.ask), copies(that.copies+1) {}
+
+	MarketData& operator=(const MarketData& that) {
+		symbol = that.symbol;
+		bid = that.bid;
+		ask = that.ask;
+		copies = that.copies+1;
+		return *this;
+	}
+
+	MarketData& operator=(MarketData&& that) {
+		symbol = that.symbol;
+		bid = that.bid;
+		ask = that.ask;
+		copies = that.copies;
+		return *this;
+	}
+
+	int symbol;
+	double bid;
+	double ask;
+	int copies;
+	char payload[224];
+};
+
+
+void DisruptorTest::testEventTranslator()
+{
+	typedef RingBuffer<MarketData, 2, SpinWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+
+	RingBuffer_t ring;
+	shared_ptr<Sequence> gatingSequence(new Sequence);
+	ring.addGatingSequence(gatingSequence);
+
+	ring.publishEvent([](MarketData& md, seq_t seq, int symbol, double bid, double ask) {
+		md.symbol = symbol + int(seq);
+		md.bid = bid;
+		md.ask = ask;
+	}, 10, 1.5, 1.75);
+	TS_ASSERT_EQUALS(ring.get(0).symbol, 10);
+	TS_ASSERT_EQUALS(ring.get(0).ask, 1.75);
+	TS_ASSERT_EQUALS(ring.get(0).copies, 0);
+
+	MarketData md;
+	md.symbol = 20;
+	ring.publishAndAssign(std::move(md));
+	TS_ASSERT_EQUALS(ring.get(1).symbol, 20);
+	TS_ASSERT_EQUALS(ring.get(1).copies, 0);
+
+	// the slot is published even when the translator throws
+	TS_ASSERT_THROWS(ring.publishEvent([](MarketData&, seq_t) { throw std::runtime_error("translator"); }), const std::runtime_error&);
+	TS_ASSERT_EQUALS(ring.cursorVal(), seq_t(2));
+
+	const int symbols[] = { 30, 31, 32 };
+	auto setSymbol = [](MarketData& md, seq_t, int symbol) { md.symbol = symbol; };
+	TS_ASSERT(ring.tryPublishEvent(setSymbol, 29));
+	TS_ASSERT(!ring.tryPublishEvent(setSymbol, 0));
+
+	gatingSequence->changeValue(3);
+	ring.publishEvents(setSymbol, symbols, symbols + 3);
+	TS_ASSERT_EQUALS(ring.cursorVal(), seq_t(6));
+	TS_ASSERT_EQUALS(ring.get(3).symbol, 29);
+	TS_ASSERT_EQUALS(ring.get(4).symbol, 30);
+	TS_ASSERT_EQUALS(ring.get(6).symbol, 32);
+
+	HPRecord::retireThread();
+}
+
+
+struct PollHandler {
+	PollHandler(int limit = -1) : sum(0), events(0), batches(0), limit(limit) {}
+
+	bool onEvent(SimpleWork& work, seq_t, bool endOfBatch) {
+		sum += work.id;
+		++events;
+		if (endOfBatch) {
+			++batches;
+		}
+		return events != limit;
+	}
+
+	long sum;
+	int events;
+	int batches;
+	int limit;
+};
+
+
+void DisruptorTest::testEventPoller()
+{
+	typedef RingBuffer<SimpleWork, 4, SpinWaitStrategy, MultiProducerSequencer, MultiProducerPublisher> RingBuffer_t;
+	typedef EventPoller<RingBuffer_t, RingBuffer_t::SingleBarrier> Poller_t;
+
+	RingBuffer_t ring;
+	std::shared_ptr<Poller_t> poller = ring.newPoller();
+	ring.addGatingSequence(poller->sequence());
+
+	PollHandler handler;
+	TS_ASSERT_EQUALS(poller->poll(handler), Poller_t::IDLE);
+
+	for (int i = 1; i <= 5; ++i) {
+		ring.publishAndAssign(i);
+	}
+	TS_ASSERT_EQUALS(poller->poll(handler), Poller_t::PROCESSING);
+	TS_ASSERT_EQUALS(handler.events, 5);
+	TS_ASSERT_EQUALS(handler.batches, 1);
+	TS_ASSERT_EQUALS(poller->sequence()->value(), seq_t(4));
+	TS_ASSERT_EQUALS(poller->poll(handler), Poller_t::IDLE);
+
+	// a claimed slot blocks the ones published after it
+	const seq_t claimed = ring.next();
+	ring.publishAndAssign(10);
+	TS_ASSERT_EQUALS(poller->poll(handler), Poller_t::GATING);
+	ring.preallocated(claimed) = 6;
+	ring.publish(claimed);
+	TS_ASSERT_EQUALS(poller->poll(handler), Poller_t::PROCESSING);
+	TS_ASSERT_EQUALS(handler.sum, 31);
+
+	// the handler ends the poll early
+	PollHandler limited(2);
+	for (int i = 0; i < 4; ++i) {
+		ring.publishAndAssign(i);
+	}
+	TS_ASSERT_EQUALS(poller->poll(limited), Poller_t::PROCESSING);
+	TS_ASSERT_EQUALS(limited.events, 2);
+	TS_ASSERT_EQUALS(poller->sequence()->value(), seq_t(8));
+
+	// a second poller behind the first one, both driven by this thread
+	std::shared_ptr<Sequence> upstream = poller->sequence();
+	std::shared_ptr<EventPoller<RingBuffer_t, RingBuffer_t::MultipleBarrier> > downstream = ring.newPoller(&upstream, &upstream + 1);
+	ring.addGatingSequence(downstream->sequence());
+	ring.removeGatingSequence(upstream);
+
+	PollHandler second;
+	TS_ASSERT_EQUALS(downstream->poll(second), Poller_t::PROCESSING);
+	TS_ASSERT_EQUALS(second.events, 9);
+	TS_ASSERT_EQUALS(downstream->poll(second), Poller_t::GATING);
+	TS_ASSERT_EQUALS(poller->poll(limited), Poller_t::PROCESSING);
+	TS_ASSERT_EQUALS(downstream->poll(second), Poller_t::PROCESSING);
+	TS_ASSERT_EQUALS(second.events, 11);
+
+	HPRecord::retireThread();
+}
+
+
+struct Tick {
+	int producer;
+	int id;
+	double price;
+};
+
+
+struct TickHandler {
+	TickHandler(int producers) : lastIds(producers, -1), count(0) {}
+
+	bool onEvent(Tick& tick, seq_t, bool) {
+		TS_ASSERT_EQUALS(tick.id, lastIds[tick.producer]+1);
+		lastIds[tick.producer] = tick.id;
+		++count;
+		return true;
+	}
+
+	std::vector<int> lastIds;
+	int count;
+};
+
+
+void DisruptorTest::testSharedRingBuffer()
+{
+	static const int COUNT = 100*1000;
+	static const int PRODUCERS = 2;
+
+	const std::string name = "/concurrent_test_" + std::to_string(getpid());
+	SharedRingBuffer<Tick>::remove(name);
+
+	SharedRingBuffer<Tick> ring(name, 6, 2);
+	SharedRingBuffer<Tick>::Consumer consumer(ring);
+	TS_ASSERT_EQUALS(ring.consumerProcess(consumer.slot()), getpid());
+	TS_ASSERT_THROWS(SharedRingBuffer<int> wrongType(name), const ExceptionLib::InvalidStateException&);
+
+	// the producers are separate processes that attach by name
+	std::vector<pid_t> children;
+	for (int p = 0; p < PRODUCERS; ++p) {
+		const pid_t pid = fork();
+		if (pid == 0) {
+			SharedRingBuffer<Tick> producerRing(name);
+			for (int i = 0; i < COUNT; ++i) {
+				producerRing.publishEvent([](Tick& tick, seq_t, int producer, int id) {
+					tick.producer = producer;
+					tick.id = id;
+					tick.price = id * 0.5;
+				}, p, i);
+			}
+			_exit(0);
+		}
+		children.push_back(pid);
+	}
+
+	TickHandler handler(PRODUCERS);
+	while (handler.count < PRODUCERS*COUNT) {
+		if (consumer.poll(handler) != SharedRingBuffer<Tick>::Consumer::PROCESSING) {
+			consumer.waitFor(consumer.sequence() + 1, 1000);
+		}
+	}
+	for (size_t i = 0; i < children.size(); ++i) {
+		int status = -1;
+		waitpid(children[i], &status, 0);
+		TS_ASSERT_EQUALS(status, 0);
+	}
+	TS_ASSERT_EQUALS(consumer.sequence(), seq_t(PRODUCERS*COUNT-1));
+
+	// nothing more is published, the wait times out
+	TS_ASSERT_EQUALS(consumer.waitFor(consumer.sequence() + 1, 1000), consumer.sequence());
+
+	// a publish after the consumer went to sleep wakes it long before its timeout
+	const seq_t next = consumer.sequence() + 1;
+	seq_t woken = 0;
+	std::chrono::duration<double> waited(0);
+	thread sleeper([&](){
+		auto start = std::chrono::steady_clock::now();
+		woken = consumer.waitFor(next, 5*1000*1000);
+		waited = std::chrono::steady_clock::now() - start;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	Tick tick = { 0, 0, 0.0 };
+	ring.publishAndAssign(tick);
+	sleeper.join();
+	TS_ASSERT_EQUALS(woken, next);
+	TS_ASSERT(waited.count() < 1.0);
+
+	TS_ASSERT_THROWS(ring.detachConsumer(2), const ExceptionLib::ProgrammingError&);
+
+	SharedRingBuffer<Tick>::remove(name);
+
+	// an opener between the creator's shm_open and ftruncate waits for the size
+	const std::string empty = name + "_empty";
+	const int fd = shm_open(empty.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	TS_ASSERT(fd >= 0);
+	TS_ASSERT_THROWS(SharedMemory(empty, 0, SharedMemory::OPEN), const ExceptionLib::Exception&);
+	thread creator([fd](){
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		if (ftruncate(fd, 4096) != 0) {
+			perror("ftruncate");
+		}
+	});
+	{
+		SharedMemory opened(empty, 0, SharedMemory::OPEN, MemoryOptions(), std::chrono::steady_clock::now() + std::chrono::seconds(5));
+		TS_ASSERT_EQUALS(opened.size(), 4096u);
+	}
+	creator.join();
+	close(fd);
+	SharedMemory::unlink(empty);
+}
+
+
+struct DurableTickHandler {
+	DurableTickHandler(const JournalHandler<Tick>& journal) : journal(journal), count(0), lastId(-1) {}
+
+	void onEvent(Tick& tick, seq_t sequence, bool) {
+		// the journal runs ahead, whatever reaches this stage is on disk
+		TS_ASSERT(sequence < journal.nextSequence());
+		TS_ASSERT_EQUALS(tick.id, lastId+1);
+		lastId = tick.id;
+		++count;
+	}
+
+	const JournalHandler<Tick>& journal;
+	std::atomic<int> count;
+	int lastId;
+};
+
+
+static void removeDirectory(const std::string& path)
+{
+	DIR* dir = opendir(path.c_str());
+	while (struct dirent* entry = readdir(dir)) {
+		const std::string name = entry->d_name;
+		if (name != "." && name != "..") {
+			unlink((path + "/" + name).c_str());
+		}
+	}
+	closedir(dir);
+	rmdir(path.c_str());
+}
+
+
+void DisruptorTest::testJournal()
+{
+	static const int COUNT = 10*1000;
+
+	typedef RingBuffer<Tick, 8, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+
+	char pattern[] = "/tmp/journal_test_XXXXXX";
+	const std::string directory = mkdtemp(pattern);
+
+	// small segments, so the journal rolls over a few times
+	JournalOptions options;
+	options.segmentSize = 64*1024;
+	options.sync = JournalOptions::MSYNC;
+
+	auto publishTicks = [](RingBuffer_t& ring, int first, int count) {
+		for (int i = first; i < first + count; ++i) {
+			ring.publishEvent([](Tick& tick, seq_t, int id) {
+				tick.producer = 0;
+				tick.id = id;
+				tick.price = id * 0.25;
+			}, i);
+		}
+	};
+
+	{
+		JournalHandler<Tick> journal(directory, options);
+		DurableTickHandler business(journal);
+		Disruptor<RingBuffer_t> disruptor;
+		disruptor.handleEventsWith(journal).then(business);
+		disruptor.start();
+
+		publishTicks(disruptor.ringBuffer(), 0, COUNT);
+		disruptor.shutdown();
+		TS_ASSERT_EQUALS(business.count, COUNT);
+		TS_ASSERT_EQUALS(journal.nextSequence(), uint64_t(COUNT));
+	}
+
+	// restart: the business logic sees the journal again, then new events
+	{
+		JournalHandler<Tick> journal(directory, options);
+		TS_ASSERT_EQUALS(journal.nextSequence(), uint64_t(COUNT));
+		DurableTickHandler business(journal);
+		Disruptor<RingBuffer_t> disruptor;
+		disruptor.handleEventsWith(journal).then(business);
+		disruptor.start();
+
+		TS_ASSERT_EQUALS(replayJournal(directory, disruptor.ringBuffer()), size_t(COUNT));
+		publishTicks(disruptor.ringBuffer(), COUNT, COUNT);
+		disruptor.shutdown();
+		TS_ASSERT_EQUALS(business.count, 2*COUNT);
+		TS_ASSERT_EQUALS(journal.nextSequence(), uint64_t(2*COUNT));
+	}
+
+	JournalReader reader(directory, sizeof(Tick));
+	int records = 0;
+	while (const void* record = reader.next()) {
+		const Tick* tick = static_cast<const Tick*>(record);
+		TS_ASSERT_EQUALS(tick->id, records);
+		TS_ASSERT_EQUALS(reader.sequence(), uint64_t(records));
+		++records;
+	}
+	TS_ASSERT_EQUALS(records, 2*COUNT);
+
+	// a torn record in the middle of the last segment ends the journal there
+	const int torn = 2*COUNT - 100;
+	Tick tornTick = { 0, torn, torn * 0.25 };
+	std::vector<std::string> segments;
+	DIR* dir = opendir(directory.c_str());
+	while (struct dirent* entry = readdir(dir)) {
+		if (entry->d_name[0] != '.') {
+			segments.push_back(directory + "/" + entry->d_name);
+		}
+	}
+	closedir(dir);
+	std::sort(segments.begin(), segments.end());
+	{
+		FILE* segment = fopen(segments.back().c_str(), "r+b");
+		std::vector<char> content(options.segmentSize);
+		content.resize(fread(&content[0], 1, content.size(), segment));
+		std::vector<char>::iterator found = std::search(content.begin(), content.end(),
+				reinterpret_cast<const char*>(&tornTick), reinterpret_cast<const char*>(&tornTick + 1));
+		TS_ASSERT(found != content.end());
+		// one bit of the price, the sequence marker stays valid
+		fseek(segment, (found - content.begin()) + offsetof(Tick, price), SEEK_SET);
+		fputc(content[(found - content.begin()) + offsetof(Tick, price)] ^ 1, segment);
+		fclose(segment);
+	}
+
+	JournalReader tornReader(directory, sizeof(Tick));
+	records = 0;
+	while (tornReader.next() != NULL) {
+		++records;
+	}
+	TS_ASSERT_EQUALS(records, torn);
+	{
+		JournalWriter writer(directory, sizeof(Tick), options);
+		TS_ASSERT_EQUALS(writer.nextSequence(), uint64_t(torn));
+	}
+
+	// a crash while the next segment was created left it empty, under its temporary name
+	unsigned long long firstSequence = 0;
+	TS_ASSERT_EQUALS(sscanf(segments.back().c_str() + directory.size(), "/journal-%llu.seg", &firstSequence), 1);
+	const size_t stride = (16 + sizeof(Tick) + 7) / 8 * 8;
+	const uint64_t nextSegment = firstSequence + (options.segmentSize - 64) / stride;
+	char leftover[64];
+	snprintf(leftover, sizeof(leftover), "/journal-%020llu.seg.tmp", static_cast<unsigned long long>(nextSegment));
+	close(open((directory + leftover).c_str(), O_RDWR | O_CREAT, 0644));
+
+	JournalReader leftoverReader(directory, sizeof(Tick));
+	records = 0;
+	while (leftoverReader.next() != NULL) {
+		++records;
+	}
+	TS_ASSERT_EQUALS(records, torn);
+	{
+		// rolls over onto the leftover name
+		JournalWriter writer(directory, sizeof(Tick), options);
+		TS_ASSERT_EQUALS(writer.nextSequence(), uint64_t(torn));
+		for (uint64_t sequence = torn; sequence < nextSegment + 10; ++sequence) {
+			Tick tick = { 0, int(sequence), sequence * 0.25 };
+			writer.append(sequence, &tick);
+		}
+	}
+	TS_ASSERT(access((directory + leftover).c_str(), F_OK) != 0);
+	JournalReader rolledReader(directory, sizeof(Tick));
+	records = 0;
+	while (const void* record = rolledReader.next()) {
+		TS_ASSERT_EQUALS(static_cast<const Tick*>(record)->id, records);
+		++records;
+	}
+	TS_ASSERT_EQUALS(records, int(nextSegment + 10));
+
+	HPRecord::retireThread();
+	removeDirectory(directory);
+}
+
+
+void DisruptorTest::testHistogram()
+{
+	Histogram histogram;
+	TS_ASSERT_EQUALS(histogram.snapshot().count(), uint64_t(0));
+	TS_ASSERT_EQUALS(histogram.snapshot().percentile(99), uint64_t(0));
+
+	for (uint64_t value = 1; value <= 100000; ++value) {
+		histogram.record(value);
+	}
+	Histogram::Snapshot s = histogram.snapshot();
+	TS_ASSERT_EQUALS(s.count(), uint64_t(100000));
+	TS_ASSERT_EQUALS(s.min(), uint64_t(1));
+	TS_ASSERT_EQUALS(s.max(), uint64_t(100000));
+	TS_ASSERT_DELTA(s.mean(), 50000.5, 0.01);
+	TS_ASSERT_DELTA(double(s.percentile(50)), 50000.0, 50000.0/32);
+	TS_ASSERT_DELTA(double(s.percentile(99)), 99000.0, 99000.0/32);
+	TS_ASSERT_EQUALS(s.percentile(100), uint64_t(100000));
+
+	// small values are exact, every value maps into the bucket bounds
+	for (uint64_t value = 0; value < 64; ++value) {
+		TS_ASSERT_EQUALS(Histogram::bucketUpperBound(Histogram::bucketIndex(value)), value);
+	}
+	for (uint64_t value = 64; value < (uint64_t(1) << 40); value = value * 3 + 1) {
+		const size_t index = Histogram::bucketIndex(value);
+		TS_ASSERT(index < Histogram::BUCKETS);
+		TS_ASSERT(value <= Histogram::bucketUpperBound(index));
+		TS_ASSERT(value > Histogram::bucketUpperBound(index - 1));
+	}
+	TS_ASSERT(Histogram::bucketIndex(~uint64_t(0)) < Histogram::BUCKETS);
+
+	// snapshots while other threads record
+	histogram.reset();
+	std::vector<thread> writers;
+	for (int t = 0; t < 2; ++t) {
+		writers.push_back(thread([&histogram](){
+			for (int i = 0; i < 100000; ++i) {
+				histogram.record(i % 1000);
+			}
+		}));
+	}
+	uint64_t lastCount = 0;
+	for (int i = 0; i < 100; ++i) {
+		const uint64_t count = histogram.snapshot().count();
+		TS_ASSERT(count >= lastCount);
+		lastCount = count;
+	}
+	for (size_t t = 0; t < writers.size(); ++t) {
+		writers[t].join();
+	}
+	TS_ASSERT_EQUALS(histogram.snapshot().count(), uint64_t(200000));
+
+#ifdef CONCURRENT_INSTRUMENTATION
+	typedef RingBuffer<SimpleWork, 10, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+	static const int COUNT = 100*1000;
+
+	RingBuffer_t ring;
+	CountdownHandler handler(COUNT);
+	BatchEventProcessor<RingBuffer_t, CountdownHandler> processor(ring, ring.newBarrier(), handler);
+	ring.addGatingSequence(processor.sequence());
+	thread consumer([&](){ processor.run(); });
+
+	for (int i = COUNT-1; i >= 0; --i) {
+		ring.publishAndAssign(i);
+	}
+	while (!handler.done) {
+		std::this_thread::yield();
+	}
+	processor.halt();
+	consumer.join();
+	HPRecord::retireThread();
+
+	Histogram::Snapshot latency = processor.stats().latencyNS.snapshot();
+	Histogram::Snapshot batches = processor.stats().batchSize.snapshot();
+	TS_ASSERT_EQUALS(latency.count(), uint64_t(COUNT));
+	TS_ASSERT(batches.count() <= uint64_t(COUNT));
+	TS_ASSERT_EQUALS(batches.mean() * batches.count(), double(COUNT));
+	std::cout << "latency p50 " << latency.percentile(50) << " ns, p99 " << latency.percentile(99)
+			<< " ns, p99.9 " << latency.percentile(99.9) << " ns, mean batch " << batches.mean() << std::endl;
+
+	// a poll that stops early records what it processed, not what was available
+	struct FirstOnly {
+		bool onEvent(SimpleWork&, seq_t, bool) {
+			return false;
+		}
+	} first;
+	RingBuffer_t polled;
+	EventPoller<RingBuffer_t> poller(polled, polled.newBarrier());
+	polled.addGatingSequence(poller.sequence());
+	for (int i = 0; i < 5; ++i) {
+		polled.publishAndAssign(i);
+	}
+	TS_ASSERT_EQUALS(poller.poll(first), EventPoller<RingBuffer_t>::PROCESSING);
+	Histogram::Snapshot polledBatches = poller.stats().batchSize.snapshot();
+	TS_ASSERT_EQUALS(polledBatches.count(), uint64_t(1));
+	TS_ASSERT_EQUALS(polledBatches.max(), uint64_t(1));
+	HPRecord::retireThread();
+#endif
+}
+
+
+namespace {
+
+	std::string currentThreadName() {
+		char name[16];
+		pthread_getname_np(pthread_self(), name, sizeof(name));
+		return name;
+	}
+
+	std::vector<int> currentThreadCPUs() {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		sched_getaffinity(0, sizeof(cpus), &cpus);
+		std::vector<int> result;
+		for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+			if (CPU_ISSET(cpu, &cpus)) {
+				result.push_back(cpu);
+			}
+		}
+		return result;
+	}
+
+	struct PlacementHandler {
+		PlacementHandler() : seen(false) {}
+
+		void onEvent(SimpleWork&, seq_t, bool) {
+			if (!seen) {
+				name = currentThreadName();
+				cpus = currentThreadCPUs();
+				seen = true;
+			}
+		}
+
+		std::string name;
+		std::vector<int> cpus;
+		std::atomic<bool> seen;
+	};
+
+	struct PlacementTask: public Task {
+		void run() {
+			name.set_value(currentThreadName());
+		}
+
+		void cancel(ExceptionLib::ExceptionBase*) {}
+
+		std::promise<std::string> name;
+	};
+}
+
+void DisruptorTest::testThreadFactory()
+{
+	// pin to a CPU this process is allowed on, whatever the machine
+	const int cpu = currentThreadCPUs().front();
+
+	ThreadOptions options;
+	options.name = "placed";
+	options.cpus.push_back(cpu);
+	ThreadFactory factory(options);
+
+	std::string name;
+	std::vector<int> cpus;
+	thread placed = factory.newThread([&](){
+		name = currentThreadName();
+		cpus = currentThreadCPUs();
+	});
+	placed.join();
+	TS_ASSERT_EQUALS(name, "placed-0");
+	TS_ASSERT_EQUALS(cpus.size(), 1u);
+	TS_ASSERT_EQUALS(cpus.front(), cpu);
+
+	// names longer than the kernel keeps are cut
+	ThreadOptions longName;
+	longName.name = "a-rather-long-thread-name";
+	ThreadFactory longNames(longName);
+	longNames.newThread([&](){ name = currentThreadName(); }).join();
+	TS_ASSERT_EQUALS(name, "a-rather-long-t");
+
+	// the body never runs when the options cannot be applied
+	ThreadOptions impossible;
+	impossible.cpus.push_back(CPU_SETSIZE);
+	ThreadFactory failing(impossible);
+	bool ran = false;
+	TS_ASSERT_THROWS(failing.newThread([&](){ ran = true; }), const ExceptionLib::Exception&);
+	TS_ASSERT(!ran);
+
+	// one entry per thread, in the order the processors were added
+	typedef RingBuffer<SimpleWork, 10, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+	std::vector<ThreadOptions> perThread(2);
+	perThread[0].name = "journal";
+	perThread[0].cpus.push_back(cpu);
+	perThread[1].name = "business";
+	ThreadFactory stages(perThread);
+
+	PlacementHandler journaler;
+	PlacementHandler business;
+	Disruptor<RingBuffer_t> disruptor;
+	disruptor.handleEventsWith(journaler).then(business);
+	disruptor.start(stages);
+	disruptor.ringBuffer().publishAndAssign(SimpleWork(1));
+	disruptor.shutdown();
+
+	TS_ASSERT(journaler.seen && business.seen);
+	TS_ASSERT_EQUALS(journaler.name, "journal-0");
+	TS_ASSERT(journaler.cpus == std::vector<int>(1, cpu));
+	TS_ASSERT_EQUALS(business.name, "business-1");
+	TS_ASSERT(business.cpus == currentThreadCPUs());
+
+	ThreadOptions workers;
+	workers.name = "worker";
+	ThreadFactory workerThreads(workers);
+	ThreadPool pool(1, workerThreads);
+	std::shared_ptr<PlacementTask> task(new PlacementTask);
+	std::future<std::string> workerName = task->name.get_future();
+	pool.pushWork(task);
+	TS_ASSERT_EQUALS(workerName.get(), "worker-0");
+	HPRecord::retireThread();
+}
+
+
+void DisruptorTest::testGatingSlots()
+{
+	typedef RingBuffer<SimpleWork, 2, YieldingWaitStrategy, SingleProducerSequencer, SingleProducerPublisher> RingBuffer_t;
+	RingBuffer_t ring;
+
+	// consumer sequences sit in adjacent cache lines of the ring's block
+	shared_ptr<Sequence> first = ring.newSequence();
+	shared_ptr<Sequence> second = ring.newSequence();
+	TS_ASSERT_EQUALS(reinterpret_cast<char*>(second.get()) - reinterpret_cast<char*>(first.get()), CONCURRENT_CACHE_LINE_SIZE);
+	TS_ASSERT_EQUALS(first->value(), Sequence::INITIAL_CURSOR_VALUE);
+
+	// a released slot is handed out again
+	Sequence* secondSlot = second.get();
+	second.reset();
+	second = ring.newSequence();
+	TS_ASSERT_EQUALS(second.get(), secondSlot);
+
+	// slots and an outside sequence gate together
+	shared_ptr<Sequence> outside(new PaddedSequence);
+	ring.addGatingSequence(first);
+	ring.addGatingSequence(outside);
+	TS_ASSERT_EQUALS(ring.minimumGatingSequence(), Sequence::INITIAL_CURSOR_VALUE);
+	for (int i = 0; i < 4; ++i) {
+		ring.publish(ring.tryNext());
+	}
+	TS_ASSERT_THROWS(ring.tryNext(), const InsufficientCapacityException&);
+
+	first->changeValue(1);
+	TS_ASSERT_THROWS(ring.tryNext(), const InsufficientCapacityException&);
+	outside->changeValue(2);
+	TS_ASSERT_EQUALS(ring.minimumGatingSequence(), 1u);
+	ring.publish(ring.tryNext(2));
+	TS_ASSERT_THROWS(ring.tryNext(), const InsufficientCapacityException&);
+
+	// only the slot gates, the producer no longer waits for the outside sequence
+	ring.removeGatingSequence(outside);
+	first->changeValue(5);
+	TS_ASSERT_EQUALS(ring.minimumGatingSequence(), 5u);
+	ring.publish(ring.tryNext(4));
+	TS_ASSERT_THROWS(ring.tryNext(), const InsufficientCapacityException&);
+
+	// a slot that does not gate is not scanned, one that is removed stops gating
+	second->changeValue(0);
+	TS_ASSERT_EQUALS(ring.minimumGatingSequence(), 5u);
+	ring.removeGatingSequence(first);
+	first->changeValue(6);
+	TS_ASSERT(ring.hasAvailableCapacity(4));
+
+	// the ring keeps a gating slot alive
+	ring.addGatingSequence(second);
+	second->changeValue(9);
+	Sequence* gatingSlot = second.get();
+	second.reset();
+	TS_ASSERT(ring.newSequence().get() != gatingSlot);
+
+	// more consumers than slots fall back to sequences of their own
+	std::vector<shared_ptr<Sequence> > many;
+	for (size_t i = 0; i < GatingSlots::CAPACITY + 2; ++i) {
+		many.push_back(ring.newSequence());
+		many.back()->changeValue(9);
+	}
+	ring.addGatingSequences(many.begin(), many.end());
+	TS_ASSERT_EQUALS(ring.minimumGatingSequence(), 9u);
+	many.back()->changeValue(8);
+	TS_ASSERT_EQUALS(ring.minimumGatingSequence(), 8u);
+	HPRecord::retireThread();
+}
+
+
+namespace {
+
+	// counts the instances of a capture that are alive
+	struct Tracked {
+		Tracked(std::atomic<int>& a) : alive(&a) { ++*alive; }
+		Tracked(Tracked&& that) : alive(that.alive) { ++*alive; }
+		~Tracked() { --*alive; }
+
+		std::atomic<int>* alive;
+	};
+
+	// move only, like most messages that carry a payload
+	struct AddOwned {
+		AddOwned(long v, std::atomic<long>& s, std::atomic<int>& alive) : value(new long(v)), sum(&s), tracked(alive) {}
+
+		void operator()() {
+			*sum += *value;
+		}
+
+		std::unique_ptr<long> value;
+		std::atomic<long>* sum;
+		Tracked tracked;
+	};
+}
+
+void DisruptorTest::testInlineActive()
+{
+	typedef InlineActive<YieldingWaitStrategy, 6> Active_t;
+	static_assert(sizeof(Active_t::Message) == 64, "one message per cache line");
+	static const long COUNT = 100*1000;
+
+	std::atomic<long> sum(0);
+	std::atomic<int> alive(0);
+	{
+		Active_t active;
+		std::vector<thread> producers;
+		for (int p = 0; p < 3; ++p) {
+			producers.push_back(thread([&](){
+				for (long i = 0; i < COUNT; ++i) {
+					active.send(AddOwned(i, sum, alive));
+				}
+			}));
+		}
+		for (size_t p = 0; p < producers.size(); ++p) {
+			producers[p].join();
+		}
+
+		std::atomic<bool> reached(false);
+		active.send([&reached]() { reached = true; });
+		while (!reached) {
+			std::this_thread::yield();
+		}
+		TS_ASSERT_EQUALS(sum.load(), 3 * (COUNT * (COUNT - 1) / 2));
+		// every capture was destroyed right after its call, not when the slot came round again
+		TS_ASSERT_EQUALS(alive.load(), 0);
+
+		// plain method calls on an object owned by the active thread
+		std::vector<int> owned;
+		for (int i = 0; i < 10; ++i) {
+			active.send([&owned, i]() { owned.push_back(i); });
+		}
+		active.finish();
+		while (!active.done()) {
+			std::this_thread::yield();
+		}
+		TS_ASSERT_EQUALS(owned.size(), 10u);
+	}
+	TS_ASSERT_EQUALS(alive.load(), 0);
+
+	// moving a message moves its capture, nothing is copied
+	InlineFunction<56> message(AddOwned(5, sum, alive));
+	InlineFunction<56> moved(std::move(message));
+	TS_ASSERT(!message && moved);
+	TS_ASSERT_EQUALS(alive.load(), 1);
+	sum = 0;
+	moved();
+	TS_ASSERT_EQUALS(sum.load(), 5);
+	moved.reset();
+	TS_ASSERT_EQUALS(alive.load(), 0);
+
+	// every message of a full ring sends one more to its own object
+	{
+		typedef InlineActive<YieldingWaitStrategy, 5> Small_t;
+		std::atomic<int> runs(0);
+		Small_t small(false);
+		for (int i = 0; i < 32; ++i) {
+			small.send([&small, &runs]() {
+				++runs;
+				small.send([&runs]() { ++runs; });
+			});
+		}
+		small.start();
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (runs < 64 && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+		TS_ASSERT_EQUALS(runs.load(), 64);
+	}
+	HPRecord::retireThread();
+}
+
+
+namespace {
+
+	// only ever touched by the thread of the active object that owns it
+	class Book {
+	public:
+		Book() : m_name("ACME"), m_bid(0), m_ask(0) {}
+
+		const std::string& name() const {
+			return m_name;
+		}
+
+		void quote(double bid, double ask) {
+			m_bid = bid;
+			m_ask = ask;
+		}
+
+		double mid() const {
+			return (m_bid + m_ask) / 2;
+		}
+
+		double spread() const {
+			if (m_ask < m_bid) {
+				throw std::runtime_error("crossed book");
+			}
+			return m_ask - m_bid;
+		}
+
+	private:
+		std::string m_name;
+		double m_bid;
+		double m_ask;
+	};
+}
+
+void DisruptorTest::testActiveCall()
+{
+	typedef InlineActive<YieldingWaitStrategy, 6> Active_t;
+	Book book;
+	Active_t books;
+	Active_t strategy;
+
+	ActiveFuture<void> quoted = books.call(&Book::quote, &book, 100.0, 101.0);
+	ActiveFuture<double> mid = books.call(&Book::mid, &book);
+	TS_ASSERT_EQUALS(mid.get(), 100.5);
+	TS_ASSERT(!mid.valid());
+	TS_ASSERT(quoted.ready());
+	quoted.get();
+
+	books.call(&Book::quote, &book, 102.0, 101.0);
+	ActiveFuture<double> spread = books.call(&Book::spread, &book);
+	TS_ASSERT_THROWS(spread.get(), const std::runtime_error&);
+
+	// the reply runs on the strategy's thread without anyone waiting for it
+	std::vector<double> mids;
+	std::thread::id replyThread;
+	std::atomic<int> replies(0);
+	for (int i = 0; i < 1000; ++i) {
+		books.call(&Book::quote, &book, double(i), double(i + 2));
+		books.callThen(strategy, [&](double m) {
+			replyThread = std::this_thread::get_id();
+			mids.push_back(m);
+			++replies;
+		}, &Book::mid, &book);
+	}
+	books.callThen(strategy, [&]() { ++replies; }, &Book::quote, &book, 1.0, 2.0);
+	while (replies < 1001) {
+		std::this_thread::yield();
+	}
+	TS_ASSERT_EQUALS(mids.size(), 1000u);
+	TS_ASSERT_EQUALS(mids.front(), 1.0);
+	TS_ASSERT_EQUALS(mids.back(), 1000.0);
+	TS_ASSERT(replyThread != std::this_thread::get_id());
+	ActiveFuture<std::thread::id> strategyThread = strategy.call([]() { return std::this_thread::get_id(); });
+	TS_ASSERT_EQUALS(strategyThread.get(), replyThread);
+
+	ActiveFuture<int> none;
+	TS_ASSERT_THROWS(none.get(), const ExceptionLib::InvalidStateException&);
+
+	// a reference result arrives as a copy, in a future and in a reply
+	ActiveFuture<std::string> name = books.call(&Book::name, &book);
+	TS_ASSERT_EQUALS(name.get(), "ACME");
+	std::string replied;
+	books.callThen(strategy, [&](std::string n) { replied = n; ++replies; }, &Book::name, &book);
+	while (replies < 1002) {
+		std::this_thread::yield();
+	}
+	TS_ASSERT_EQUALS(replied, "ACME");
+
+	// calls sent after finish() fail instead of waiting forever, their captures are released
+	{
+		std::atomic<long> sum(0);
+		std::atomic<int> alive(0);
+		Active_t stopped(false);
+		stopped.finish();
+		stopped.send(AddOwned(1, sum, alive));
+		stopped.start();
+		while (!stopped.done()) {
+			std::this_thread::yield();
+		}
+		ActiveFuture<double> late = stopped.call(&Book::mid, &book);
+		TS_ASSERT_THROWS(late.get(), const ExceptionLib::InvalidStateException&);
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (alive > 0 && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+		TS_ASSERT_EQUALS(alive.load(), 0);
+		TS_ASSERT_EQUALS(sum.load(), 0);
+	}
+	HPRecord::retireThread();
+}
+
+namespace {
+
+	template<class A>
+	struct CountMessage: public A::Message {
+		CountMessage(std::atomic<long>& c, bool endBatch) : count(c), end(endBatch) {}
+
+		bool execute() {
+			++count;
+			return end;
+		}
+
+		std::atomic<long>& count;
+		bool end;
+	};
+}
+
+namespace {
+
+	template<class A>
+	struct SendToSelfMessage: public A::Message {
+		SendToSelfMessage(A& a, std::atomic<long>& c) : active(a), count(c) {}
+
+		bool execute() {
+			++count;
+			active.send(typename A::MsgPtr(new CountMessage<A>(count, false)));
+			return false;
+		}
+
+		A& active;
+		std::atomic<long>& count;
+	};
+}
+
+void DisruptorTest::testActiveBatchRun()
+{
+	typedef ::Active<YieldingWaitStrategy, 6> Active_t;
+	typedef CountMessage<Active_t> Count;
+	static const long COUNT = 100*1000;
+
+	std::atomic<long> count(0);
+	{
+		Active_t active;
+		std::vector<thread> producers;
+		for (int p = 0; p < 3; ++p) {
+			producers.push_back(thread([&](){
+				for (long i = 0; i < COUNT; ++i) {
+					// ending a batch early must not lose what follows it
+					active.send(Active_t::MsgPtr(new Count(count, i % 7 == 0)));
+				}
+			}));
+		}
+		for (size_t p = 0; p < producers.size(); ++p) {
+			producers[p].join();
+		}
+
+		// parked consumer, a lone message has to wake it
+		while (count < 3*COUNT) {
+			std::this_thread::yield();
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		active.send(Active_t::MsgPtr(new Count(count, false)));
+		while (count < 3*COUNT + 1) {
+			std::this_thread::yield();
+		}
+	}
+	TS_ASSERT_EQUALS(count.load(), 3*COUNT + 1);
+
+	// the semaphore strategy is still usable
+	{
+		Active_t active(std::make_shared<MessageWaitStrategy>());
+		for (long i = 0; i < 1000; ++i) {
+			active.send(Active_t::MsgPtr(new Count(count, false)));
+		}
+	}
+	TS_ASSERT_EQUALS(count.load(), 3*COUNT + 1001);
+
+	// not started, messages stay queued for waitForMessage
+	{
+		Active_t idle(false);
+		TS_ASSERT(!idle.waitForMessage(5));
+		idle.send(Active_t::MsgPtr(new Count(count, false)));
+		TS_ASSERT(idle.waitForMessage(5));
+		TS_ASSERT(idle.popMessage()->execute() == false);
+		TS_ASSERT(!idle.waitForMessage(0));
+	}
+
+	// every message of a full ring sends one more to its own object
+	{
+		typedef ::Active<> Small_t;
+		std::atomic<long> runs(0);
+		Small_t small(false);
+		for (int i = 0; i < 32; ++i) {
+			small.send(Small_t::MsgPtr(new SendToSelfMessage<Small_t>(small, runs)));
+		}
+		small.start();
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (runs < 64 && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+		TS_ASSERT_EQUALS(runs.load(), 64);
+	}
+	HPRecord::retireThread();
+}
+
+namespace {
+
+	template<class A>
+	struct RecordMessage: public A::Message {
+		RecordMessage(std::vector<int>& o, int i) : order(o), id(i) {}
+
+		bool execute() {
+			order.push_back(id);
+			return false;
+		}
+
+		std::vector<int>& order;
+		int id;
+	};
+}
+
+void DisruptorTest::testPriorityActive()
+{
+	typedef PriorityActive<YieldingWaitStrategy, 2, 8> Active_t;
+	typedef RecordMessage<Active_t> Record;
+
+	// queued before the start, high ids are 0..199 in lane 0 and low ids 1000.. in lane 1
+	std::vector<int> order;
+	{
+		Active_t active(false, 2, 4);
+		for (int i = 0; i < 20; ++i) {
+			active.send(Active_t::MsgPtr(new Record(order, 1000 + i)));
+		}
+		for (int i = 0; i < 200; ++i) {
+			active.send(Active_t::MsgPtr(new Record(order, i)), 0);
+		}
+		TS_ASSERT_THROWS(active.send(Active_t::MsgPtr(new Record(order, -1)), 2), const ExceptionLib::ProgrammingError&);
+		active.start();
+	}
+
+	// every message ran once, FIFO within a lane, finish() waited for both lanes
+	TS_ASSERT_EQUALS(order.size(), 220u);
+	std::vector<int> high, low;
+	for (size_t i = 0; i < order.size(); ++i) {
+		(order[i] < 1000 ? high : low).push_back(order[i]);
+	}
+	TS_ASSERT_EQUALS(high.size(), 200u);
+	TS_ASSERT_EQUALS(low.size(), 20u);
+	for (size_t i = 0; i < high.size(); ++i) {
+		TS_ASSERT_EQUALS(high[i], int(i));
+	}
+	for (size_t i = 0; i < low.size(); ++i) {
+		TS_ASSERT_EQUALS(low[i], 1000 + int(i));
+	}
+
+	// two batches of four from lane 0, then lane 1 was passed over too often and gets one
+	TS_ASSERT_EQUALS(order[7], 7);
+	TS_ASSERT_EQUALS(order[8], 1000);
+	TS_ASSERT_EQUALS(order[12], 8);
+
+	// a control message overtakes a full data lane
+	std::atomic<bool> release(false);
+	std::atomic<long> data(0);
+	std::atomic<long> dataAtControl(-1);
+	{
+		Active_t active;
+		struct Blocker: public Active_t::Message {
+			Blocker(std::atomic<bool>& r) : release(r) {}
+			bool execute() {
+				while (!release) {
+					std::this_thread::yield();
+				}
+				return false;
+			}
+			std::atomic<bool>& release;
+		};
+		struct Data: public Active_t::Message {
+			Data(std::atomic<long>& c) : count(c) {}
+			bool execute() { ++count; return false; }
+			std::atomic<long>& count;
+		};
+		struct Control: public Active_t::Message {
+			Control(std::atomic<long>& c, std::atomic<long>& seen) : count(c), seenAt(seen) {}
+			bool execute() { seenAt = count.load(); return false; }
+			std::atomic<long>& count;
+			std::atomic<long>& seenAt;
+		};
+
+		active.send(Active_t::MsgPtr(new Blocker(release)));
+		for (int i = 0; i < 200; ++i) {
+			active.send(Active_t::MsgPtr(new Data(data)));
+		}
+		active.send(Active_t::MsgPtr(new Control(data, dataAtControl)), 0);
+		release = true;
+	}
+	TS_ASSERT_EQUALS(data.load(), 200);
+	TS_ASSERT(dataAtControl.load() >= 0);
+	TS_ASSERT(dataAtControl.load() <= 64);
+
+	// every message of a full lane sends one more to the same lane
+	{
+		typedef PriorityActive<YieldingWaitStrategy, 2, 5> Small_t;
+		std::atomic<long> runs(0);
+		Small_t small(false);
+		for (int i = 0; i < 32; ++i) {
+			small.send(Small_t::MsgPtr(new SendToSelfMessage<Small_t>(small, runs)));
+		}
+		small.start();
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (runs < 64 && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+		TS_ASSERT_EQUALS(runs.load(), 64);
+	}
+
+	// a producer that keeps the lane full after finish() neither runs nor holds the thread
+	{
+		typedef PriorityActive<YieldingWaitStrategy, 2, 5> Small_t;
+		struct Slow: public Small_t::Message {
+			Slow(std::atomic<long>& c) : count(c) {}
+			bool execute() {
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				++count;
+				return false;
+			}
+			std::atomic<long>& count;
+		};
+
+		std::atomic<long> runs(0);
+		std::atomic<bool> stop(false);
+		long sent = 0;
+		Small_t small;
+		// the only producer of lane 0, so the capacity check keeps it from blocking
+		thread producer([&](){
+			while (!stop) {
+				if (small.hasAvailableCapacity(1, 0)) {
+					small.send(Small_t::MsgPtr(new Slow(runs)), 0);
+					++sent;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		small.finish();
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (!small.done() && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::yield();
+		}
+		TS_ASSERT(small.done());
+		const long runsAtDone = runs.load();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		stop = true;
+		producer.join();
+		TS_ASSERT_EQUALS(runs.load(), runsAtDone);
+		TS_ASSERT(runsAtDone < sent);
+	}
+	HPRecord::retireThread();
+}
+
+namespace {
+
+	// holds the only pool thread until released
+	struct GateTask: public Task {
+		GateTask() : open(false) {}
+
+		void run() {
+			while (!open) {
+				std::this_thread::yield();
+			}
+		}
+
+		void cancel(ExceptionLib::ExceptionBase*) {}
+
+		std::atomic<bool> open;
+	};
+
+	struct ActorState {
+		ActorState() : running(false), count(0), overlaps(0) {}
+
+		std::atomic<bool> running;
+		long count; // only touched by the actor's messages
+		std::atomic<int> overlaps;
+	};
+
+	template<class A>
+	struct ExclusiveMessage: public A::Message {
+		ExclusiveMessage(ActorState& s) : state(s) {}
+
+		bool execute() {
+			if (state.running.exchange(true)) {
+				++state.overlaps;
+			}
+			++state.count;
+			state.running = false;
+			return false;
+		}
+
+		ActorState& state;
+	};
+
+	// fills its own mailbox with trySend, then sends past it
+	template<class A>
+	struct FloodMessage: public A::Message {
+		FloodMessage(A& a, std::vector<int>& o, int n) : active(a), order(o), sends(n), accepted(0), refused(0) {}
+
+		bool execute() {
+			int id = 0;
+			while (active.trySend(typename A::MsgPtr(new RecordMessage<A>(order, id)))) {
+				++id;
+			}
+			accepted = id;
+			++refused;
+			while (id < sends) {
+				active.send(typename A::MsgPtr(new RecordMessage<A>(order, id++)));
+			}
+			// the overflow keeps the order, so a later trySend waits behind it
+			if (!active.trySend(typename A::MsgPtr(new RecordMessage<A>(order, -1)))) {
+				++refused;
+			}
+			return false;
+		}
+
+		A& active;
+		std::vector<int>& order;
+		const int sends;
+		int accepted;
+		int refused;
+	};
+}
+
+void DisruptorTest::testScheduledActive()
+{
+	// a busy actor gives the thread up after its budget
+	{
+		typedef ScheduledActive<YieldingWaitStrategy, 6> Actor;
+		typedef RecordMessage<Actor> Record;
+		std::vector<int> order;
+		ThreadPool pool(1);
+		std::shared_ptr<GateTask> gate(new GateTask);
+		pool.pushWork(gate);
+		{
+			Actor busy(pool, 10);
+			Actor other(pool, 10);
+			TS_ASSERT(busy.idle());
+			for (int i = 0; i < 30; ++i) {
+				busy.send(Actor::MsgPtr(new Record(order, i)));
+			}
+			other.send(Actor::MsgPtr(new Record(order, 1000)));
+			TS_ASSERT(!busy.idle());
+			gate->open = true;
+		}
+		TS_ASSERT_EQUALS(order.size(), 31u);
+		TS_ASSERT_EQUALS(order[9], 9);
+		TS_ASSERT_EQUALS(order[10], 1000);
+		TS_ASSERT_EQUALS(order[11], 10);
+		TS_ASSERT_EQUALS(order[30], 29);
+		TS_ASSERT_THROWS(Actor(pool, 0), const ExceptionLib::ProgrammingError&);
+	}
+
+	// many actors on few threads, none of them ever runs twice at once
+	{
+		typedef ScheduledActive<YieldingWaitStrategy, 4> Actor;
+		typedef ExclusiveMessage<Actor> Exclusive;
+		static const int ACTORS = 1000;
+		static const int MESSAGES = 50;
+
+		std::vector<ActorState> states(ACTORS);
+		ThreadPool pool(3);
+		{
+			std::vector<std::unique_ptr<Actor> > actors;
+			for (int a = 0; a < ACTORS; ++a) {
+				actors.push_back(std::unique_ptr<Actor>(new Actor(pool, 4)));
+			}
+			std::vector<thread> producers;
+			for (int p = 0; p < 2; ++p) {
+				producers.push_back(thread([&](){
+					for (int m = 0; m < MESSAGES; ++m) {
+						for (int a = 0; a < ACTORS; ++a) {
+							actors[a]->send(Actor::MsgPtr(new Exclusive(states[a])));
+						}
+					}
+				}));
+			}
+			for (size_t p = 0; p < producers.size(); ++p) {
+				producers[p].join();
+			}
+		}
+
+		long total = 0;
+		int overlaps = 0;
+		for (int a = 0; a < ACTORS; ++a) {
+			total += states[a].count;
+			overlaps += states[a].overlaps;
+		}
+		TS_ASSERT_EQUALS(total, 2L*MESSAGES*ACTORS);
+		TS_ASSERT_EQUALS(overlaps, 0);
+	}
+
+	// a message on the only pool thread sends to its own full mailbox
+	{
+		typedef ScheduledActive<YieldingWaitStrategy, 4> Actor;
+		typedef FloodMessage<Actor> Flood;
+		static const int SENDS = 100;
+
+		std::vector<int> order;
+		ThreadPool pool(1);
+		std::shared_ptr<Flood> flood;
+		{
+			Actor actor(pool);
+			flood.reset(new Flood(actor, order, SENDS));
+			actor.send(flood);
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while (!actor.idle() && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::yield();
+			}
+			TS_ASSERT(actor.idle());
+		}
+		std::vector<int> expected;
+		for (int i = 0; i < SENDS; ++i) {
+			expected.push_back(i);
+		}
+		TS_ASSERT_EQUALS(flood->accepted, 16);
+		TS_ASSERT_EQUALS(flood->refused, 2);
+		TS_ASSERT(order == expected);
+	}
+
+	// a message on the only pool thread destroys an actor whose activation is queued behind it
+	{
+		typedef ScheduledActive<YieldingWaitStrategy, 4> Actor;
+		typedef RecordMessage<Actor> Record;
+		struct Destroy: public Actor::Message {
+			Destroy(std::unique_ptr<Actor>& a) : actor(a) {}
+			bool execute() { actor.reset(); return false; }
+			std::unique_ptr<Actor>& actor;
+		};
+
+		std::vector<int> order;
+		ThreadPool pool(1);
+		std::shared_ptr<GateTask> gate(new GateTask);
+		pool.pushWork(gate);
+		std::unique_ptr<Actor> victim(new Actor(pool));
+		{
+			Actor destroyer(pool);
+			destroyer.send(Actor::MsgPtr(new Destroy(victim)));
+			for (int i = 0; i < 10; ++i) {
+				victim->send(Actor::MsgPtr(new Record(order, i)));
+			}
+			gate->open = true;
+		}
+		TS_ASSERT(!victim);
+		TS_ASSERT_EQUALS(order.size(), 10u);
+		for (size_t i = 0; i < order.size(); ++i) {
+			TS_ASSERT_EQUALS(order[i], int(i));
+		}
+	}
+	HPRecord::retireThread();
+}
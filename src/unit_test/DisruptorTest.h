@@ -13,6 +13,54 @@ public:
 	void test1P1C();
 
 	void test1P1CBlockingQueue();
+
+	void test1P1CBatchEventProcessor();
+
+	void testBatchClaim();
+
+	void test3P1CBatchPublish();
+
+	void testCacheLineLayout();
+
+	void testRuntimeSizedRing();
+
+	void test1P3CWorkerPool();
+
+	void testDiamond();
+
+	void testBlockingWaitStrategies();
+
+	void testBackoffWaitStrategies();
+
+	void testProducerWaitStrategies();
+
+	void testStaticBarriers();
+
+	void test4P1CHazardRecords();
+
+	void testEventTranslator();
+
+	void testEventPoller();
+
+	void testSharedRingBuffer();
+
+	void testJournal();
+
+	void testHistogram();
+
+	void testThreadFactory();
+
+	void testGatingSlots();
+
+	void testInlineActive();
+
+	void testActiveCall();
+
+	void testActiveBatchRun();
+
+	void testPriorityActive();
+
+	void testScheduledActive();
 };
 
 